@@ -0,0 +1,41 @@
+#ifndef BLINK_H
+#define BLINK_H
+
+#include <Arduino.h>
+
+/*
+Blink engine for whatever is being edited: tubes and indicator LEDs are switched on and off together from the
+system tick interrupt, which only flips the phase and flags the change. The loop asks blinkPhaseChanged() (one
+flag, no millis()) and redraws with blinkBlankMask() and blinkLeds(), so a frame is latched twice per period
+and not on every loop.
+*/
+
+const unsigned int blink_half_period = 500; // how long blinking digits are shown and how long blanked (in milliseconds)
+
+/**
+ * Starts blinking, everything is shown first
+ * @param tubes tubes that blink (combination of hour_1 ... second_2, a pair blinks together)
+ * @param leds LEDs that blink with them (any bit mask, it is given back by blinkLeds())
+ * @param halfPeriod how long they are shown and how long blanked (in milliseconds)
+ */
+void blinkStart(byte tubes, byte leds, unsigned int halfPeriod = blink_half_period);
+
+// stops blinking, everything is shown
+void blinkStop();
+
+// shows everything again and starts the period over, so a value that was just changed can be seen right away
+void blinkRestart();
+
+// counts ticks and flips the phase when it is time (called from the system tick interrupt)
+void blinkTick();
+
+// returns true once after every phase change (and after blinkStart(), blinkStop() and blinkRestart())
+bool blinkPhaseChanged();
+
+// returns tubes that are blanked at the moment, to be combined with the blank mask of the displayed digits
+byte blinkBlankMask();
+
+// returns LEDs that are lit at the moment
+byte blinkLeds();
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef BRIGHTNESS_H
+#define BRIGHTNESS_H
+
+#include <Arduino.h>
+
+/*
+Brightness of the display is controlled by PWM on the display control pin. Pin 2 has no hardware PWM output,
+so Timer2 runs in fast PWM mode (976Hz) and its overflow and compare interrupts set and clear the pin.
+Brightness levels are gamma corrected, so every step looks equally bright to the eye, and the display
+fades in and out from the system tick interrupt, so the main loop doesn't do anything for it.
+*/
+
+const byte brightness_levels = 32;   // brightness levels from 0 (off) to 31 (full brightness)
+const byte fade_step_ticks = 16;     // ticks between fade steps, full fade takes 31 * 16 * 1.024 = 508ms
+
+/**
+ * Starts PWM with the display turned off
+ * @param level brightness of the display when it is turned on (1...31)
+ */
+void brightnessBegin(byte level);
+
+/**
+ * Sets brightness of the display when it is turned on, display fades to it if it is on
+ * @param level brightness level (1...31)
+ */
+void setBrightness(byte level);
+
+// fades the display in to the set brightness
+void turnDisplayOn();
+
+// fades the display out
+void turnDisplayOff();
+
+// returns true if the display is turned on (or fading in)
+bool displayIsOn();
+
+// returns true if the tubes are lit at the moment (also while fading out)
+bool displayIsLit();
+
+// moves brightness one step closer to the target when it is time for it (called from the system tick interrupt)
+void brightnessTick();
+
+#endif
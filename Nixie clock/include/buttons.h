@@ -0,0 +1,57 @@
+#ifndef BUTTONS_H
+#define BUTTONS_H
+
+#include <Arduino.h>
+
+/*
+Buttons are debounced all at once with vertical counters: every button has a 2 bit counter, bit 0 of
+all counters is stored in one byte and bit 1 in another, so every button is debounced with a few
+byte operations no matter how many there are (up to 8). Button state changes after 4 equal samples
+that differ from it. Sampling is done from the system tick interrupt every few ticks, with a sample
+every 10 ticks buttons are debounced for about 4 * 10 * 1.024 = 41ms.
+*/
+
+/**
+ * Starts reading buttons, all buttons are released at the beginning
+ * @param sampleTicks buttons are sampled every sampleTicks ticks
+ */
+void buttonsBegin(byte sampleTicks);
+
+/**
+ * Changes how often buttons are sampled
+ * @param sampleTicks buttons are sampled every sampleTicks ticks
+ */
+void setButtonSampleTicks(byte sampleTicks);
+
+// takes a sample of all buttons and debounces them
+void sampleButtons();
+
+/**
+ * Debounces a sample of all buttons, sampleButtons() passes the button pins (also used by the host benchmark)
+ * @param pressed bit n is 1 while button n is down
+ */
+void debounceButtons(byte pressed);
+
+// samples buttons when it is time for it (called from the system tick interrupt)
+void buttonsTick();
+
+/**
+ * Checks if the button was pressed since the last call, every press is reported once
+ * @param buttonIndex the index of the button array to be read (button pins are storred in array)
+ * @return true if the button was pressed
+ */
+bool buttonPressed(int buttonIndex);
+
+// returns mask of buttons pressed since the last call and clears them (bit n is button n)
+byte buttonPresses();
+
+// returns mask of buttons released since the last call and clears them (bit n is button n)
+byte buttonReleases();
+
+// returns mask of buttons that are currently held down (bit n is button n)
+byte buttonsDown();
+
+// returns true while a button pin reads pressed or a button is debounced as held down, so a press isn't lost in sleep
+bool buttonsBusy();
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <Arduino.h>
+#include "ds3231.h"
+
+/*
+Calibration of the DS3231 against a reference clock on the host (tools/nixie.py calibrate). The host sends
+calibration marks with the reference time at which it sent them, the pin change interrupt of the RX pin takes
+the time of the start bit of the frame, so the offset of the last RTC second edge from the reference second is
+known to a few microseconds plus the serial latency of the host. The host fits these offsets over many seconds,
+which gives the drift in ppm, and corrects it with the aging offset register. Time can be set aligned to a
+reference second as well: the RTC is written a given delay after the start bit of the frame.
+The MCU stays awake while marks keep coming, because Timer0 stops in power down and micros() wouldn't count
+the time since the second edge.
+*/
+
+const unsigned long calibration_session_time = 5000; // MCU stays awake this long after a mark (in milliseconds)
+const unsigned long max_set_delay = 1000000;         // longest delay of an aligned time set (in microseconds)
+
+// RTC second edge compared to the reference
+struct __attribute__((packed)) CalibrationMark
+{
+  uint32_t ticks; // square wave ticks so far
+  uint32_t phase; // time from the last second edge to the start bit (in microseconds)
+  int32_t offset; // reference time within its second at which the RTC second started (in microseconds, -500000...499999)
+};
+
+// takes the time of the next start bit on the RX pin and keeps the MCU awake for calibration_session_time
+void calibrationArm();
+
+// returns true while a calibration session is running
+bool calibrationActive();
+
+/**
+ * Compares the last RTC second edge with the reference time of the frame that was just received
+ * @param referenceMicros reference time within its second at the start bit of the frame (in microseconds)
+ * @param mark filled with the comparison
+ * @return false if the start bit wasn't taken (the frame arrived before the capture was armed)
+ */
+bool calibrationMark(uint32_t referenceMicros, CalibrationMark &mark);
+
+/**
+ * Sets date and time of the RTC a delay after the start bit of the frame that was just received, so the new
+ * second starts at a reference second, waits for it (the loop is blocked up to the delay)
+ * @param time date and time to be set
+ * @param delay time from the start bit to the reference second (in microseconds, at most max_set_delay)
+ * @return false if the start bit wasn't taken or the delay has already passed
+ */
+bool setRtcTimeAligned(const RtcTime &time, uint32_t delay);
+
+#endif
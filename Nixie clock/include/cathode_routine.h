@@ -0,0 +1,40 @@
+#ifndef CATHODE_ROUTINE_H
+#define CATHODE_ROUTINE_H
+
+#include <Arduino.h>
+
+/*
+Cathode routine is necessary for longevity of NIXIE tubes, it lights up every digit one after another
+(0...9...1) and repeats it for a certain ammount of time. It runs as a state machine, so it never blocks:
+start it with startCathodeRoutine() and keep calling cathodeRoutineStep() until it returns false.
+*/
+
+/**
+ * Starts cathode routine, this should be done as frequently as possible, but every 15 minutes will be ok
+ * @param timeInterval how long will cathode routine run (in milliseconds), last sweep through the digits is always finished
+ * @param digitDelay time between digit changes (in milliseconds)
+ */
+void startCathodeRoutine(const unsigned long timeInterval, const unsigned long digitDelay);
+
+/**
+ * Starts adaptive cathode routine which exercises cathodes according to their wear statistics: every tube gets
+ * timeInterval of exercise which is shared between its cathodes in proportion to how much less they were lit
+ * than its most used cathode, so rarely shown digits are lit the longest and the most used ones not at all
+ * @param timeInterval how long is every tube exercised (in milliseconds)
+ * @param digitDelay time between digit changes (in milliseconds)
+ */
+void startAdaptiveCathodeRoutine(const unsigned long timeInterval, const unsigned long digitDelay);
+
+/**
+ * Shows the next digit if it is time for it, returns immediately
+ * @return true while cathode routine is running
+ */
+bool cathodeRoutineStep();
+
+// stops cathode routine before it has completed
+void stopCathodeRoutine();
+
+// returns true while cathode routine is running
+bool cathodeRoutineRunning();
+
+#endif
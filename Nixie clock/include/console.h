@@ -0,0 +1,27 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <Arduino.h>
+#include "debug.h"
+#include "profiler.h"
+
+/*
+Single character commands over serial monitor, they are available when debugging or profiling:
+'p' prints profiling statistics, 'r' resets them, 'w' prints cathode wear statistics, 'o' prints learned occupancy
+Characters are received by the host protocol parser, which passes on everything that isn't part of a frame
+or the rest of a dropped one.
+*/
+
+#if DEBUG == 1 || PROFILING == 1
+#define console_command(c) consoleCommand(c)
+#else
+#define console_command(c)
+#endif
+
+/**
+ * Executes a serial monitor command
+ * @param command received character
+ */
+void consoleCommand(char command);
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef DEBUG_H
+#define DEBUG_H
+
+#include <Arduino.h>
+
+const unsigned long serial_baud = 57600; // baud rate of serial monitor and host protocol
+
+// debugging
+#define DEBUG 0 // choose to debug or not; 1 is debugging 0 is not (messages go through the logger in log.h)
+
+#endif
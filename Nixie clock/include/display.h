@@ -0,0 +1,80 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <Arduino.h>
+#include "shift_register.h"
+
+const int tube_count = TUBE_COUNT; // number of NIXIE tubes, from left to right: hour1, hour2, minute1, minute2 (, second1, second2)
+const int neon_count = NEON_COUNT; // number of neon lamps
+const byte all_neons = (1 << neon_count) - 1;
+
+// define values for blanking digits, they can be combined to blank more than one digit
+#define hour_1 0x01
+#define hour_2 0x02
+#define minute_1 0x04
+#define minute_2 0x08
+#define second_1 0x10
+#define second_2 0x20
+
+// number of frames that were latched and number of frames that were skipped because they were already displayed,
+// updated from interrupt as well
+extern volatile unsigned long framesLatched;
+extern volatile unsigned long framesSkipped;
+
+/**
+ * Encodes digits into a frame
+ * @param frame frame to be filled (frame_bytes long)
+ * @param digits digits of every tube from left to right (0...9)
+ * @param blankMask which digits are blanked (combination of hour_1 ... second_2 or 0)
+ * @param neonMask which neons are lit (bit n is neon n)
+ */
+void encodeFrame(byte *frame, const byte *digits, byte blankMask, byte neonMask = 0);
+
+/**
+ * Displays digits, shift registers are only updated if the frame differs from the displayed one
+ * @param digits digits of every tube from left to right (0...9)
+ * @param blankMask which digits are blanked (combination of hour_1 ... second_2 or 0)
+ * @param neonMask which neons are lit (bit n is neon n)
+ * @return true if a new frame was latched
+ */
+bool displayDigits(const byte *digits, byte blankMask, byte neonMask = 0);
+
+/**
+ * Displays frame, shift registers are only updated if the frame differs from the displayed one
+ * @param frame frame to be displayed (frame_bytes long)
+ * @return true if a new frame was latched
+ */
+bool displayFrame(const byte *frame);
+
+/**
+ * Shifts the frame into the shift registers without latching it, so it can be latched from an interrupt
+ * with latchArmedFrame() exactly when it is needed (any other display update disarms it)
+ * @param frame frame to be displayed next (frame_bytes long)
+ * @return true if the frame is armed, false if it is already displayed
+ */
+bool armFrame(const byte *frame);
+
+/**
+ * Keeps the armed frame from being latched, shift registers still hold it
+ */
+void disarmFrame();
+
+/**
+ * Latches the armed frame to the outputs, safe to call from an interrupt
+ * @return true if there was an armed frame
+ */
+bool latchArmedFrame();
+
+/**
+ * Decodes which digit every tube shows at the moment (safe to call from an interrupt)
+ * @param digits digit of every tube from left to right, 0xFF if the tube is blank
+ * @return false if the display is being updated right now and digits aren't known
+ */
+bool getDisplayedDigits(byte *digits);
+
+/**
+ * Forgets the displayed frame, so the next frame is always latched (use after shift registers are reset)
+ */
+void invalidateDisplay();
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef DS3231_H
+#define DS3231_H
+
+#include <Arduino.h>
+
+/*
+Thin interface to the DS3231 RTC module, everything else only talks to the RTC through these functions.
+Registers are accessed over the interrupt driven TWI driver (twi.h) in fast mode (400kHz). Time can be read in
+the background: ds3231StartRead() starts a burst read of the time registers and returns right away, the end is
+seen from ds3231ReadBusy() or a callback. The other functions wait for their transfer, they are only used at
+startup and when settings change. The native build runs this code against a simulated DS3231 on the TWI bus
+(lib/host).
+*/
+
+const unsigned long ds3231_i2c_frequency = 400000;
+
+// date and time as kept by the RTC module
+struct RtcTime
+{
+  int year;    // 2000...2099
+  byte month;  // 1...12
+  byte day;    // 1...31
+  byte hour;   // 0...23
+  byte minute; // 0...59
+  byte second; // 0...59
+};
+
+// time from the ds3231Write() call to the write of the seconds register, which resets the countdown chain
+// (start, address, register and seconds bytes at 400kHz and their interrupts, in microseconds)
+const unsigned long ds3231_set_latency = 75;
+
+// one step of the aging offset register changes the crystal frequency by about 0.1ppm (at 25°C)
+const float ds3231_aging_step_ppm = 0.1;
+
+/**
+ * Returns day of week of a date
+ * @param year year value (2000...2099)
+ * @param month month value (1...12)
+ * @param day day value (1...31)
+ * @return 1...7, Monday is 1 (like the day register of the module)
+ */
+byte dayOfWeek(int year, byte month, byte day);
+
+/**
+ * Returns number of days in a month
+ * @param year year value (2000...2099)
+ * @param month month value (1...12)
+ * @return 28...31
+ */
+byte daysInMonth(int year, byte month);
+
+/**
+ * Starts I2C communication with the RTC module
+ * @return true if the module answers
+ */
+bool ds3231Begin();
+
+/**
+ * Reads date and time, waits for the transfer
+ * @param time read date and time, left as it was if the module doesn't answer
+ * @return true if it was read
+ */
+bool ds3231Read(RtcTime &time);
+
+/**
+ * Starts reading date and time in the background (registers are copied at the start condition)
+ * @param done called from the TWI interrupt when the read is done or has failed (can be nullptr)
+ * @return false if the bus is busy
+ */
+bool ds3231StartRead(void (*done)() = nullptr);
+
+// returns true while a background read is running
+bool ds3231ReadBusy();
+
+/**
+ * Gets the result of the last background read
+ * @param time read date and time
+ * @return false if the read failed
+ */
+bool ds3231ReadResult(RtcTime &time);
+
+/**
+ * Sets date and time, the countdown chain of the module is reset so the new second starts right now
+ * @param time date and time to be set
+ */
+void ds3231Write(const RtcTime &time);
+
+// turns on the 1Hz square wave output, seconds register changes on its falling edge
+void ds3231EnableSquareWave();
+
+// returns the aging offset register, positive values slow the crystal down
+int8_t ds3231ReadAgingOffset();
+
+/**
+ * Writes the aging offset register and starts a temperature conversion, which is when the new offset is applied
+ * @param offset positive values slow the crystal down, about 0.1ppm per step
+ */
+void ds3231WriteAgingOffset(int8_t offset);
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef EEPROM_LAYOUT_H
+#define EEPROM_LAYOUT_H
+
+// addresses of everything that is stored in EEPROM (1024 bytes on ATmega328)
+const int wear_address = 0;        // cathode wear statistics: 4 byte header and an unsigned long for every cathode (6 tubes at most)
+const int settings_address = 256;  // ring of settings records
+const int settings_size = 256;
+const int occupancy_address = 512; // learned occupancy: 4 byte header and 4 bits for every 15 minutes of the week
+
+// wear statistics and occupancy are saved this often (in seconds, see intervalPassed() in timekeeper.h)
+const unsigned long eeprom_save_interval = 3600;
+
+#endif
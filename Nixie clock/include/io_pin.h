@@ -0,0 +1,76 @@
+#ifndef IO_PIN_H
+#define IO_PIN_H
+
+#include <Arduino.h>
+
+/*
+Pins described at compile time, every pin is a type and its port and bit are template arguments, so an access
+like Board::Latch::high() is inlined into a single sbi/cbi (sbic/sbis for reads) instead of going through
+the pin tables of digitalWrite() and digitalRead().
+Arduino pin number is kept for code that still needs it (attachInterrupt, digitalWrite backend).
+*/
+
+/*
+Registers of an ATmega328 port and its pin change interrupt group, register types are taken from avr/io.h
+(volatile uint8_t on the MCU, recording register objects of lib/host in the native build)
+*/
+#define IO_PORT(name, letter, group)                                         \
+  struct name                                                                \
+  {                                                                          \
+    static auto port() -> decltype((PORT##letter)) { return PORT##letter; }  \
+    static auto ddr() -> decltype((DDR##letter)) { return DDR##letter; }     \
+    static auto pin() -> decltype((PIN##letter)) { return PIN##letter; }     \
+    static auto pcmsk() -> decltype((PCMSK##group)) { return PCMSK##group; } \
+    static const uint8_t pcie = PCIE##group;                                 \
+  }
+
+IO_PORT(PortB, B, 0);
+IO_PORT(PortC, C, 1);
+IO_PORT(PortD, D, 2);
+
+/**
+ * A single IO pin
+ * @param Port one of the port types above
+ * @param bit bit of the pin in the port registers
+ * @param arduinoPin Arduino pin number of the same pin
+ */
+template <class Port, uint8_t bit, uint8_t arduinoPin>
+struct IoPin
+{
+  static const uint8_t number = arduinoPin;
+  static const uint8_t mask = 1 << bit;
+
+  static void output() { Port::ddr() |= mask; }
+  static void input()
+  {
+    Port::ddr() &= ~mask;
+    Port::port() &= ~mask;
+  }
+  static void inputPullup()
+  {
+    Port::ddr() &= ~mask;
+    Port::port() |= mask;
+  }
+
+  static void high() { Port::port() |= mask; }
+  static void low() { Port::port() &= ~mask; }
+  static void write(bool value)
+  {
+    if (value)
+      high();
+    else
+      low();
+  }
+  static void toggle() { Port::pin() = mask; } // writing 1 to PINx toggles the output
+  static bool read() { return Port::pin() & mask; }
+
+  // pin change interrupt of the pin, group interrupt is enabled as well and stays enabled
+  static void enablePinChange()
+  {
+    Port::pcmsk() |= mask;
+    PCICR |= _BV(Port::pcie);
+  }
+  static void disablePinChange() { Port::pcmsk() &= ~mask; }
+};
+
+#endif
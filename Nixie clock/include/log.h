@@ -0,0 +1,92 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+#include "debug.h"
+
+/*
+Deferred logger, a log call only copies the address of its format string (kept in flash) and its arguments
+into a RAM ring, so it takes a few microseconds and can be used from interrupts as well.
+Text is formatted and written to serial by logFlush(), one line at a time and only as much as fits into the
+serial transmit buffer, so the loop never waits on the serial port.
+Format strings understand %d, %u, %x and %% with an optional zero padded width (%02d), arguments are stored as
+long (at most log_max_arguments of them). If the ring is full, events are dropped and their number is logged.
+Levels above LOG_LEVEL are removed at compile time, their calls (and the evaluation of their arguments) cost no
+flash, RAM or cycles. With LOG_LEVEL_NONE the logger itself is left out.
+*/
+
+// log levels
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+// everything is logged while debugging, can be overridden with a build flag (-D LOG_LEVEL=2)
+#ifndef LOG_LEVEL
+#if DEBUG == 1
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#else
+#define LOG_LEVEL LOG_LEVEL_NONE
+#endif
+#endif
+
+const byte log_max_arguments = 3;
+const byte log_buffer_size = 128; // size of the ring in bytes (power of 2), an event takes 3 + 4 * arguments bytes
+const byte log_line_size = 80;    // longer lines are cut
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define log_error(format, ...) logEvent(PSTR(format), ##__VA_ARGS__)
+#else
+#define log_error(format, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARNING
+#define log_warning(format, ...) logEvent(PSTR(format), ##__VA_ARGS__)
+#else
+#define log_warning(format, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define log_info(format, ...) logEvent(PSTR(format), ##__VA_ARGS__)
+#else
+#define log_info(format, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define log_debug(format, ...) logEvent(PSTR(format), ##__VA_ARGS__)
+#else
+#define log_debug(format, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL > LOG_LEVEL_NONE
+
+/**
+ * Stores an event into the log ring (use the log_... macros, they keep the format string in flash)
+ * @param format format string in flash
+ */
+void logEvent(const char *format);
+void logEvent(const char *format, long a);
+void logEvent(const char *format, long a, long b);
+void logEvent(const char *format, long a, long b, long c);
+
+// writes logged events to serial as long as there is room in the transmit buffer, called from the loop
+void logFlush();
+
+// returns true if every logged event has been handed to the serial port
+bool logIdle();
+
+#else
+
+inline void logFlush()
+{
+}
+
+inline bool logIdle()
+{
+  return true;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef MENU_H
+#define MENU_H
+
+#include <Arduino.h>
+
+/*
+Setup menu engine. Pages are declared in a table, every page edits one value within a range, blinks the tubes
+and indicator LEDs that belong to it (blink.h) and shows the edited values with a function of its own, so date,
+alarm or settings pages are only new table entries. The menu is driven by events: menuPoll() takes the button
+presses since its last call and returns right away if there are none, the blink phase didn't change and nothing
+asked for a redraw. Display and LEDs are only redrawn when the value, the page or the blink phase changed (or
+menuRedraw() was called), so the loop costs the same no matter how many pages there are. The blinking digits are
+shown for a whole period after every change of the value. Button 0 goes to the next page, buttons 1 and 2 change
+the value up and down (wrapping around at the ends), after the last page the finish function of the menu applies
+the edited values.
+*/
+
+// indicator LEDs of a page, they can be combined
+const byte MENU_HOUR_LED = 0x01;
+const byte MENU_MINUTE_LED = 0x02;
+
+// one page of the menu
+struct MenuPage
+{
+  int *value;                   // edited value
+  int minimum;                  // smallest value
+  int maximum;                  // largest value
+  byte tubes;                   // tubes that blink on this page (combination of hour_1 ... second_2 or 0)
+  byte leds;                    // indicator LEDs that blink with them (MENU_HOUR_LED, MENU_MINUTE_LED or 0)
+  void (*show)(byte blankMask); // displays the edited values with the blinking tubes blanked in blankMask
+};
+
+/**
+ * Opens the menu at its first page, button presses from before are dropped
+ * @param pages table of pages
+ * @param count number of pages
+ * @param finish called after the last page
+ */
+void menuEnter(const MenuPage *pages, byte count, void (*finish)());
+
+// returns true while the menu is open
+bool menuActive();
+
+// handles button presses since the last call and redraws what changed (called from the loop)
+void menuPoll();
+
+// makes the next menuPoll() redraw the page
+void menuRedraw();
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+#include <Arduino.h>
+
+/*
+Occupancy learning: the week is split into slots of 15 minutes and every slot has a score (0...15) of how
+often the PIR sensor saw motion in it in the last weeks. When time moves on into the next slot, the score of
+the slot that ended moves a quarter of the way towards 15 if there was motion in it and towards 0 if there
+wasn't. Slots start in the middle, where the display behaves like it always did: a slot becomes habitually
+occupied after 2 weeks in a row with motion and rarely occupied after 3 weeks without.
+
+Scores take 4 bits, two slots per byte (336 bytes of RAM). They are loaded from EEPROM at startup and written
+back every hour of RTC time (time in power down included), one byte per loop and only when EEPROM is ready, so
+saving never blocks the loop. Bytes that didn't change aren't written, every cell is written at most twice a week.
+
+Motion detection uses scores to turn the display off sooner when the current and the next slot are rarely
+occupied and to light it a few minutes before a habitually occupied slot starts, without waiting for motion.
+*/
+
+#define PREDICTIVE_DISPLAY 1 // choose to adapt display to learned occupancy; 1 is adapting 0 is fixed timeout
+
+const byte occupancy_slot_minutes = 15;
+const int occupancy_slots = 7 * 24 * 60 / occupancy_slot_minutes;
+const byte occupancy_rare = 3;        // slots with a lower score are rarely occupied
+const byte occupancy_habitual = 11;   // slots with this score or more are habitually occupied
+const byte occupancy_prelight = 5;    // display is lit this many minutes before a habitually occupied slot
+const byte occupancy_min_timeout = 5; // shortened timeout is never below this (in minutes)
+
+// loads scores from EEPROM, every slot starts in the middle if nothing valid is stored
+void occupancyBegin();
+
+/**
+ * Records motion in the current slot and scores the slot that ended when time moves on (called from the loop)
+ * @param weekday day of week (1...7, Monday is 1)
+ * @param hours current hour value
+ * @param minutes current minute value
+ * @param motion true if the PIR sensor sees motion
+ */
+void occupancyUpdate(byte weekday, int hours, int minutes, bool motion);
+
+/**
+ * Returns display timeout for the current slot
+ * @param timeout timeout from settings (in minutes)
+ * @return a quarter of it (at least occupancy_min_timeout) if this slot and the next are rarely occupied,
+ * timeout otherwise
+ */
+unsigned long occupancyTimeout(unsigned long timeout);
+
+/**
+ * Returns display timeout after the display was lit ahead of a slot and nobody came yet
+ * @param timeout timeout from settings (in minutes)
+ * @return a quarter of it, at least occupancy_min_timeout
+ */
+unsigned long occupancyShortTimeout(unsigned long timeout);
+
+// returns true once per slot when the next slot is habitually occupied and starts in occupancy_prelight minutes
+bool occupancyPrelight();
+
+/**
+ * Returns score of a slot
+ * @param weekday day of week (1...7, Monday is 1)
+ * @param hours hour value
+ * @param minutes minute value
+ * @return 0 (never occupied) ... 15 (always occupied)
+ */
+byte occupancyScore(byte weekday, int hours, int minutes);
+
+// writes scores to EEPROM once per hour, one byte per call (called from the loop)
+void occupancySaveStep();
+
+// returns true while scores are being saved
+bool occupancySaving();
+
+// prints score of every slot, one day per line
+void printOccupancy();
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef PINS_H
+#define PINS_H
+
+#include <Arduino.h>
+#include "io_pin.h"
+
+/*
+Wiring of the clock, resolved at compile time (see io_pin.h).
+Arduino Uno and Pro Mini (pro16MHzatmega328) both carry an ATmega328P with the same pin numbering, so they
+share one layout; the board is picked from the define of the PlatformIO environment, another board needs its
+own layout here. The native build (NIXIE_NATIVE) simulates an Uno.
+*/
+
+// layout of the clock board on an ATmega328P
+struct Atmega328Layout
+{
+  typedef IoPin<PortB, PB1, 9> Latch;          // RCK of TPIC6B595
+  typedef IoPin<PortB, PB2, 10> MasterReset;   // SRCLR of all TPIC6B595 IC-s (SS of SPI)
+  typedef IoPin<PortB, PB3, 11> Data;          // SERIAL IN of TPIC6B595 (MOSI)
+  typedef IoPin<PortB, PB4, 12> Clock;         // SRCK of TPIC6B595 (move it to pin 13, PB5, when using SPI backend)
+  typedef IoPin<PortD, PD4, 4> HourLed;        // led that will light up when adjusting hours
+  typedef IoPin<PortD, PD5, 5> MinuteLed;      // led that will light up when adjusting minutes
+  typedef IoPin<PortD, PD6, 6> Button0;        // menu button
+  typedef IoPin<PortD, PD7, 7> Button1;        // up button
+  typedef IoPin<PortB, PB0, 8> Button2;        // down button
+  typedef IoPin<PortD, PD3, 3> Sensor;         // PIR motion sensor
+  typedef IoPin<PortD, PD2, 2> DisplayControl; // high voltage supply of the tubes, PWM from Timer2 interrupts
+  typedef IoPin<PortC, PC0, A0> SquareWave;    // DS3231 square wave, INT0 and INT1 are taken so pin change interrupt is used
+  typedef IoPin<PortD, PD0, 0> SerialRx;       // wakes the MCU up and times calibration frames (pin change interrupt)
+  typedef IoPin<PortC, PC4, A4> Sda;           // TWI data of the DS3231
+  typedef IoPin<PortC, PC5, A5> Scl;           // TWI clock of the DS3231
+};
+
+#if defined(ARDUINO_AVR_UNO) || defined(ARDUINO_AVR_PRO) || defined(NIXIE_NATIVE)
+typedef Atmega328Layout Board;
+#else
+#error "No pin layout for this board in pins.h"
+#endif
+
+// Control variables:
+const int number_of_buttons = 3; // number of buttons connected
+const byte button_mask = (1 << number_of_buttons) - 1;
+
+// buttons have pullups
+inline void buttonPinsBegin()
+{
+  Board::Button0::inputPullup();
+  Board::Button1::inputPullup();
+  Board::Button2::inputPullup();
+}
+
+// reads all buttons at once, bit n is the level of button n
+inline byte readButtonPins()
+{
+  return Board::Button0::read() | Board::Button1::read() << 1 | Board::Button2::read() << 2;
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <Arduino.h>
+#include "console.h"
+
+/*
+When the display is turned off and there is nothing else to do, the MCU is put into power down sleep.
+It is woken up by the PIR sensor, any button, serial data or the DS3231 1Hz square wave, so time keeps
+running from square wave ticks and the loop runs for a moment every second. The first byte received over
+serial while sleeping is lost (the UART isn't clocked), so the host has to repeat an unanswered frame. Power down only wakes up on level
+interrupts of INT0/INT1, so the PIR sensor (pin 3) and buttons use pin change interrupts instead.
+Timer0 is stopped while sleeping, so millis() only counts the time spent awake.
+Sleep is not used while debugging or profiling, because it stops the serial port.
+*/
+
+#if DEBUG == 0 && PROFILING == 0
+#define LOW_POWER 1 // choose to sleep or not; 1 is sleeping 0 is not
+#else
+#define LOW_POWER 0
+#endif
+
+// number of times the MCU was put to sleep
+extern unsigned long sleepCount;
+
+// prepares wake up sources and turns off ADC
+void powerBegin();
+
+// puts the MCU to sleep if the display is off and nothing is running, returns after it wakes up
+void sleepWhenIdle();
+
+// returns number of seconds spent awake
+unsigned long secondsAwake();
+
+// returns number of seconds spent sleeping
+unsigned long secondsAsleep();
+
+#endif
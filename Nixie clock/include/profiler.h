@@ -0,0 +1,59 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+
+// profiling of loop stages
+#define PROFILING 0 // choose to profile or not; 1 is profiling 0 is not
+
+/*
+Execution time of every stage is measured with Timer1 (0.5us resolution), minimum, maximum, mean and a
+histogram with power of 2 bins (bin n counts times from 2^(n-1) to 2^n - 1 microseconds) are kept.
+Statistics are printed and reset with serial monitor commands (see console.h).
+When profiling is turned off all profiling macros are empty, so they cost nothing.
+*/
+
+// stages of the loop that are measured
+enum ProfileStage
+{
+  STAGE_LOOP,
+  STAGE_GET_TIME,
+  STAGE_TIME_CHANGE,
+  STAGE_MOTION,
+  STAGE_BUTTONS,
+  STAGE_MENU,
+  STAGE_COUNT
+};
+
+#if PROFILING == 1
+#define profile_begin() profilerBegin()
+#define profile_start(stage) profileStart(stage)
+#define profile_stop(stage) profileStop(stage)
+#else
+#define profile_begin()
+#define profile_start(stage)
+#define profile_stop(stage)
+#endif
+
+// starts Timer1, statistics are printed over serial communication started by protocolBegin()
+void profilerBegin();
+
+/**
+ * Starts measuring execution time of a stage
+ * @param stage stage that is measured
+ */
+void profileStart(ProfileStage stage);
+
+/**
+ * Stops measuring execution time of a stage and adds it to the statistics
+ * @param stage stage that is measured
+ */
+void profileStop(ProfileStage stage);
+
+// prints out statistics of every stage
+void printProfile();
+
+// clears statistics of every stage
+void resetProfile();
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <Arduino.h>
+
+/*
+Binary protocol for setting up clocks from a host (see tools/nixie.py). Every frame is:
+  0xA5 | payload length | command | payload | CRC low byte | CRC high byte
+CRC is CRC-16/CCITT (reflected, 0x8408, initial value 0xFFFF, as in _crc_ccitt_update) of length, command
+and payload, multi byte values are little endian. Every request is answered with a frame whose command is
+the request command with the highest bit set and whose first payload byte is the status.
+Bytes are received into the serial receive ring buffer by its interrupt and parsed a few at a time from
+the loop, so the loop is never blocked. Frames with a wrong CRC are dropped without an answer.
+Other bytes are serial monitor commands (console.h), but not while the line is busy after a frame: the rest
+of a dropped or oversized frame is skipped until no byte came for 100ms.
+*/
+
+const byte protocol_sync = 0xA5;
+const byte protocol_max_payload = 48;
+
+// commands
+const byte COMMAND_PING = 0x01;             // no payload, answer: protocol version
+const byte COMMAND_SET_TIME = 0x02;         // year (2 bytes), month, day, hour, minute, second
+const byte COMMAND_READ_CONFIG = 0x03;      // no payload, answer: Settings
+const byte COMMAND_WRITE_CONFIG = 0x04;     // Settings, they are applied and saved to EEPROM
+const byte COMMAND_READ_STATS = 0x05;       // no payload, answer: 8 unsigned longs (see protocol.cpp)
+const byte COMMAND_READ_WEAR = 0x06;        // tube, answer: tube and on time of its 10 cathodes (unsigned longs)
+const byte COMMAND_RUN_ROUTINE = 0x07;      // no payload, starts adaptive cathode routine
+const byte COMMAND_CALIBRATION_MARK = 0x08; // reference microseconds (4 bytes), answer: CalibrationMark (see calibration.h)
+const byte COMMAND_AGING_OFFSET = 0x09;     // no payload to read or new offset (1 byte), answer: aging offset
+const byte COMMAND_SET_TIME_ALIGNED = 0x0A; // as COMMAND_SET_TIME and delay in microseconds (4 bytes), see calibration.h
+
+// answer status
+const byte STATUS_OK = 0;
+const byte STATUS_UNKNOWN_COMMAND = 1;
+const byte STATUS_BAD_LENGTH = 2;
+const byte STATUS_BUSY = 3;
+const byte STATUS_BAD_VALUE = 4;
+
+// starts serial communication
+void protocolBegin();
+
+/**
+ * Parses received bytes and executes complete frames, returns immediately
+ * @param menuActive true while time is being adjusted from the menu, commands that change time or display are refused
+ */
+void protocolPoll(bool menuActive);
+
+// returns true if no frame is being received or sent
+bool protocolIdle();
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <Arduino.h>
+
+/*
+Settings are stored in EEPROM as a log of records in a ring of slots, every record has a sequence number
+and a CRC. Saving writes a new record into the next slot (one byte per loop, only when EEPROM is ready),
+so every save goes to different cells and an interrupted save leaves the previous record valid. At startup
+all slots are read once and the valid record with the newest sequence number is loaded into RAM, which
+always takes the same time no matter how many times settings were saved.
+*/
+
+// fixed size fields and no padding, so EEPROM records and protocol frames are the same in the native build
+struct __attribute__((packed)) Settings
+{
+  byte cathodeInterval;        // cathode routine runs every cathodeInterval minutes
+  byte motionTimeout;          // display turns off after motionTimeout minutes without motion
+  uint16_t routineLength;      // how long is every tube exercised in cathode routine (in milliseconds)
+  byte routineDigitDelay;      // time between digit changes in cathode routine (in milliseconds)
+  byte buttonSampleTicks;      // ticks between button samples, buttons are debounced for 4 samples
+  byte brightness;             // brightness level when the display is on (1...31)
+  byte transition;             // digit transition mode (TransitionMode)
+  byte resyncInterval;         // local time is corrected from RTC module every resyncInterval minutes
+};
+
+// settings that are in use, loaded from EEPROM at startup
+extern Settings settings;
+
+// loads the newest valid settings record from EEPROM, default settings are used if there is none
+void settingsBegin();
+
+// starts saving settings into the next slot, the save is done by settingsSaveStep()
+void saveSettings();
+
+// writes one byte of the record that is being saved when EEPROM is ready (called from the loop)
+void settingsSaveStep();
+
+// returns true while settings are being saved
+bool settingsSaving();
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef SHIFT_REGISTER_H
+#define SHIFT_REGISTER_H
+
+#include <Arduino.h>
+
+/*
+Output backends for the TPIC6B595 chain, all of them shift out the same 40 bit frame:
+SHIFT_BACKEND_DIGITAL - original bit banging through digitalWrite()
+SHIFT_BACKEND_PORT    - bit banging through compile time pin writes (single sbi/cbi, see pins.h) on the same pins
+SHIFT_BACKEND_SPI     - hardware SPI, SRCK has to be wired to pin 13 (SCK) instead of pin 12
+*/
+#define SHIFT_BACKEND_DIGITAL 0
+#define SHIFT_BACKEND_PORT 1
+#define SHIFT_BACKEND_SPI 2
+
+#ifndef SHIFT_BACKEND
+#define SHIFT_BACKEND SHIFT_BACKEND_PORT // choose output backend
+#endif
+
+// tubes on the chain (4 for HH:MM or 6 for HH:MM:SS) with 10 cathodes each and neon lamps (colons or decimal points) after them,
+// boards with another layout set them in build_flags (see platformio.ini)
+#ifndef TUBE_COUNT
+#define TUBE_COUNT 4
+#endif
+#ifndef NEON_COUNT
+#define NEON_COUNT 0
+#endif
+
+static_assert(TUBE_COUNT == 4 || TUBE_COUNT == 6, "TUBE_COUNT has to be 4 or 6");
+static_assert(NEON_COUNT >= 0 && NEON_COUNT <= 8, "NEON_COUNT has to be 0...8 (neons are lit by a byte mask)");
+
+// chain has one TPIC6B595 for every 8 outputs, outputs that are left over at the end stay unconnected
+const int frame_bits = TUBE_COUNT * 10 + NEON_COUNT;
+const int frame_bytes = (frame_bits + 7) / 8;
+
+/*
+Frame layout: bit n of the frame is stored in frame[n / 8] at bit position n % 8 and
+bit 0 is shifted out first, so it ends up at the far end of the chain (all frame_bytes * 8 bits are shifted)
+*/
+
+// transfer time of the last frame (in microseconds)
+extern unsigned long frameTransferTime;
+
+/**
+ * Prepares pins or SPI peripheral for the selected backend
+ */
+void shiftRegisterBegin();
+
+/**
+ * Shifts out the whole frame with the selected backend and latches it to the outputs
+ * @param frame frame to be shifted out (frame_bytes long)
+ */
+void shiftOutFrame(const byte *frame);
+
+/**
+ * Shifts out the whole frame with the selected backend without latching it, outputs keep the old frame
+ * @param frame frame to be shifted out (frame_bytes long)
+ */
+void shiftFrame(const byte *frame);
+
+/**
+ * Latches the frame that was shifted out with shiftFrame() to the outputs (safe to call from an interrupt)
+ */
+void latchFrame();
+
+/**
+ * Measures and logs frame transfer time of every backend, outputs are not latched
+ * so the displayed frame doesn't change (only does something when debug messages are logged)
+ */
+void reportShiftBackendTiming();
+
+#endif
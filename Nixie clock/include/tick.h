@@ -0,0 +1,20 @@
+#ifndef TICK_H
+#define TICK_H
+
+#include <Arduino.h>
+
+/*
+System tick runs on Timer0 compare A interrupt, Timer0 is already running for millis(), so the tick comes
+once per Timer0 overflow (every 1.024ms) without changing its settings. Everything that has to happen
+regularly in the background (button sampling, display fading, digit transitions, cathode wear...) is called from this interrupt.
+*/
+
+const float tick_period = 1.024; // time between ticks (in milliseconds)
+
+// starts system tick interrupt
+void tickBegin();
+
+// returns number of ticks since tickBegin()
+unsigned long tickCount();
+
+#endif
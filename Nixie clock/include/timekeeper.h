@@ -0,0 +1,100 @@
+#ifndef TIMEKEEPER_H
+#define TIMEKEEPER_H
+
+#include <Arduino.h>
+
+/*
+Local software clock: seconds are counted from the DS3231 1Hz square wave interrupt, so local time
+changes exactly on the RTC second edge, and time is only read from the RTC (over I2C) every resync interval.
+If the square wave is missing, time is extrapolated from millis() instead and the RTC is polled around
+minute changes until it confirms the new minute, so displayed minute never runs ahead of the RTC.
+*/
+
+// number of RTC reads in the last full hour (of RTC time) and number of time requests which would all have been RTC
+// reads before
+extern unsigned long rtcReadsPerHour;
+extern unsigned long timeRequestsPerHour;
+
+// time between the RTC second edge and display latch (in microseconds), updated from interrupt as well
+extern volatile unsigned long lastEdgeLatency;
+extern volatile unsigned long maxEdgeLatency;
+
+/**
+ * Reads time from the RTC module for the first time and starts counting square wave ticks
+ * @param resyncInterval how often is local time corrected from RTC module (in milliseconds)
+ */
+void timekeeperBegin(unsigned long resyncInterval);
+
+/**
+ * Changes how often is local time corrected from RTC module
+ * @param resyncInterval time between RTC reads (in milliseconds)
+ */
+void setResyncInterval(unsigned long resyncInterval);
+
+/**
+ * Gets current time, RTC module is only read if it is time to resync
+ * @param hours current hour value
+ * @param minutes current minute value
+ * @param seconds current second value
+ */
+void getLocalTime(int &hours, int &minutes, int &seconds);
+
+// returns day of week of the time from the last getLocalTime() call, 1...7 (Monday is 1)
+byte getLocalWeekday();
+
+/**
+ * Sets time of the RTC module (date is kept) and resyncs local time, nothing is set if the date can't be read
+ * @param hours hour value to be set
+ * @param minutes minute value to be set
+ * @param seconds second value to be set
+ */
+void setRtcTime(int hours, int minutes, int seconds);
+
+/**
+ * Sets date and time of the RTC module and resyncs local time
+ * @param year year value (2000...2099)
+ * @param month month value (1...12)
+ * @param day day value (1...31)
+ * @param hours hour value to be set
+ * @param minutes minute value to be set
+ * @param seconds second value to be set
+ */
+void setRtcDateTime(int year, int month, int day, int hours, int minutes, int seconds);
+
+// asks for the displayed time to be refreshed, time was set while the same minute is displayed (called after time was set)
+void requestTimeRefresh();
+
+// returns true once after requestTimeRefresh() was called
+bool timeRefreshRequested();
+
+// returns true if seconds are counted from the square wave
+bool squareWaveActive();
+
+// returns number of square wave ticks (seconds) since timekeeperBegin()
+unsigned long squareWaveTicks();
+
+/*
+returns seconds since timekeeperBegin(), counted from the square wave so time spent in power down is counted as
+well (millis() only counts awake time), and from millis() while the square wave is missing (the MCU doesn't sleep
+then)
+*/
+unsigned long elapsedSeconds();
+
+/**
+ * Returns true when an interval of elapsedSeconds() has passed and starts the next one
+ * @param start elapsedSeconds() when the interval started, moved on to now when it returns true
+ * @param interval length of the interval (in seconds)
+ */
+bool intervalPassed(unsigned long &start, unsigned long interval);
+
+/**
+ * Gets the last square wave tick (RTC second edge)
+ * @param ticks number of ticks so far
+ * @param micros micros() at the tick
+ */
+void lastSecondEdge(unsigned long &ticks, unsigned long &micros);
+
+// call after time change was latched to the display, measures the latency from the last second edge
+void recordEdgeLatency();
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef TRANSITIONS_H
+#define TRANSITIONS_H
+
+#include <Arduino.h>
+
+/*
+Digit transitions are played when displayed time changes. Every transition is a sequence of steps stored
+in PROGMEM, a step tells for how many ticks it is shown and what the changing tubes show: old digit,
+new digit or a digit that is k digits before the new one (rolling). Frames are generated from the steps
+one at a time in the loop and shifted into the shift registers ahead of time (armFrame() in display.h), the
+system tick interrupt only latches them when their step is due, so it never spends the time of a whole frame
+transfer and transitions take no RAM per frame. A step is shown a tick later if the loop was late with it.
+Only tubes whose digit changes are animated.
+*/
+
+enum TransitionMode
+{
+  TRANSITION_NONE,          // digits change instantly
+  TRANSITION_SLOT_MACHINE,  // changing digits roll through all digits and slow down
+  TRANSITION_CROSSFADE,     // old and new digit alternate quickly, new digit is shown longer and longer
+  TRANSITION_CASCADE        // changing digits roll one after another from left to right
+};
+
+/**
+ * Selects transition that is played when displayed time changes
+ * @param mode transition mode
+ */
+void setTransitionMode(TransitionMode mode);
+
+// returns selected transition mode
+TransitionMode transitionMode();
+
+/**
+ * Starts transition from one set of digits to another, new digits are left on the display when it is done
+ * @param fromDigits digits that are displayed now, from left to right
+ * @param fromBlank which of the displayed digits are blanked
+ * @param fromNeons which neons are lit now (bit n is neon n)
+ * @param toDigits digits that will be displayed, from left to right
+ * @param toBlank which of the new digits are blanked
+ * @param toNeons which neons are lit when it is done
+ */
+void startTransition(const byte *fromDigits, byte fromBlank, byte fromNeons, const byte *toDigits, byte toBlank,
+                     byte toNeons);
+
+// stops transition, display keeps the last frame
+void stopTransition();
+
+// returns true while transition is playing
+bool transitionRunning();
+
+// shifts the next step of the transition out without latching it, returns immediately (called from the loop)
+void transitionPoll();
+
+// latches the next step of the transition when it is time for it (called from the system tick interrupt)
+void transitionTick();
+
+#endif
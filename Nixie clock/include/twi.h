@@ -0,0 +1,66 @@
+#ifndef TWI_H
+#define TWI_H
+
+#include <Arduino.h>
+
+/*
+Interrupt driven TWI (I2C) master for register based devices like the DS3231. A transfer sends the register
+address and then either writes the data or reads it after a repeated start. Every bus event is handled by the
+TWI interrupt, so starting a transfer returns right away and the loop never waits on the bus: a burst read of
+the 7 DS3231 time registers takes about 0.25ms at 400kHz (0.9ms at 100kHz) while the CPU does something else.
+Completion is seen from twiBusy() and, if given, a callback that is run from the interrupt.
+Only one transfer runs at a time.
+*/
+
+const byte twi_max_write = 8; // longest write, data is copied so the caller's buffer may change right away
+
+enum TwiResult
+{
+  TWI_OK,
+  TWI_RUNNING,
+  TWI_NACK,  // device didn't answer its address or refused data
+  TWI_ERROR  // bus error, lost arbitration or a transfer that didn't finish in time
+};
+
+/**
+ * Turns on the TWI with internal pullups on SDA and SCL
+ * @param frequency SCL frequency, 100000 (standard mode) or 400000 (fast mode)
+ */
+void twiBegin(unsigned long frequency);
+
+/**
+ * Starts reading registers of a device
+ * @param address 7 bit device address
+ * @param reg first register, the device increments the register address itself
+ * @param data where the registers go, it has to stay valid until the transfer is done
+ * @param length number of registers (1...255)
+ * @param done called from the interrupt when the transfer is done or has failed (can be nullptr)
+ * @return false if another transfer is running
+ */
+bool twiStartRead(byte address, byte reg, byte *data, byte length, void (*done)() = nullptr);
+
+/**
+ * Starts writing registers of a device
+ * @param address 7 bit device address
+ * @param reg first register
+ * @param data register values, they are copied
+ * @param length number of registers (at most twi_max_write)
+ * @param done called from the interrupt when the transfer is done or has failed (can be nullptr)
+ * @return false if another transfer is running or data is too long
+ */
+bool twiStartWrite(byte address, byte reg, const byte *data, byte length, void (*done)() = nullptr);
+
+// returns true while a transfer is running
+bool twiBusy();
+
+// returns result of the last transfer, TWI_RUNNING while it is running
+TwiResult twiResult();
+
+/**
+ * Waits until the running transfer is done, for setup and rare writes where blocking doesn't matter; if the bus
+ * hangs, the TWI is reset after a few milliseconds and the transfer ends with TWI_ERROR
+ * @return true if it succeeded
+ */
+bool twiWait();
+
+#endif
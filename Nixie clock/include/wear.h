@@ -0,0 +1,40 @@
+#ifndef WEAR_H
+#define WEAR_H
+
+#include <Arduino.h>
+
+/*
+On time of every cathode is counted by sampling the latched frame from the system tick interrupt every
+wear_sample_ticks ticks while the display is lit, so counters are in units of 64 * 1.024 = 65.536ms
+(an unsigned long lasts for almost 9 years). Counters are loaded from EEPROM at startup and written back
+every hour of RTC time (time in power down included), one byte per loop and only when EEPROM is ready, so saving
+never blocks the loop.
+*/
+
+const byte wear_sample_ticks = 64;
+const float wear_unit = 0.065536; // one counter step (in seconds)
+
+// loads counters from EEPROM, they start at 0 if nothing valid is stored
+void wearBegin();
+
+// counts one sample of lit cathodes when it is time for it (called from the system tick interrupt)
+void wearTick();
+
+// writes counters to EEPROM once per hour, one byte per call (called from the loop)
+void wearSaveStep();
+
+// returns true while counters are being saved
+bool wearSaving();
+
+/**
+ * Returns on time of a cathode
+ * @param tube tube from the left
+ * @param digit digit of the cathode (0...9)
+ * @return on time in units of wear_unit
+ */
+unsigned long cathodeUsage(int tube, int digit);
+
+// prints on time of every cathode in hours
+void printWearStatistics();
+
+#endif
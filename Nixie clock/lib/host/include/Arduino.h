@@ -0,0 +1,129 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+/*
+The part of the Arduino core that the clock uses, implemented on the host against the virtual time,
+pin and interrupt model of host.h. Calls that take time on the MCU move virtual time forward.
+*/
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <type_traits>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef uint16_t word;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+const uint8_t A0 = 14, A1 = 15, A2 = 16, A3 = 17, A4 = 18, A5 = 19;
+
+#define lowByte(w) ((uint8_t)((w) & 0xFF))
+#define highByte(w) ((uint8_t)((w) >> 8))
+#define bit(b) (1UL << (b))
+#define bitRead(value, b) (((value) >> (b)) & 0x01)
+#define constrain(x, low, high) ((x) < (low) ? (low) : ((x) > (high) ? (high) : (x)))
+
+// functions instead of the macros of the Arduino core, so standard headers still compile
+template <class A, class B>
+typename std::common_type<A, B>::type min(A a, B b)
+{
+  return a < b ? a : b;
+}
+
+template <class A, class B>
+typename std::common_type<A, B>::type max(A a, B b)
+{
+  return a > b ? a : b;
+}
+
+// the sketch
+void setup();
+void loop();
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void interrupts();
+void noInterrupts();
+
+// pins in Arduino numbering (0...19), same ports as on the Uno
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+class __FlashStringHelper;
+#define F(string) (reinterpret_cast<const __FlashStringHelper *>(string))
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t data) = 0;
+  size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *text);
+
+  size_t print(const char *text);
+  size_t print(const __FlashStringHelper *text);
+  size_t print(char c);
+  size_t print(unsigned char value, int base = DEC);
+  size_t print(int value, int base = DEC);
+  size_t print(unsigned int value, int base = DEC);
+  size_t print(long value, int base = DEC);
+  size_t print(unsigned long value, int base = DEC);
+  size_t print(double value, int digits = 2);
+
+  size_t println();
+  template <class T>
+  size_t println(T value)
+  {
+    return print(value) + println();
+  }
+  template <class T>
+  size_t println(T value, int format)
+  {
+    return print(value, format) + println();
+  }
+};
+
+#define SERIAL_TX_BUFFER_SIZE 64
+#define SERIAL_RX_BUFFER_SIZE 64
+
+// USART, transmitted bytes go to the listeners of host.h right away, received ones come from hostSerialInput()
+class HardwareSerial : public Print
+{
+public:
+  void begin(unsigned long baud);
+  void end();
+  int available();
+  int peek();
+  int read();
+  int availableForWrite();
+  void flush();
+  size_t write(uint8_t data) override;
+  using Print::write;
+  operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif
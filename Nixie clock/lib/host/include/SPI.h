@@ -0,0 +1,35 @@
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+#include <Arduino.h>
+
+#define SPI_MODE0 0x00
+
+// SPI master on pins 11 (MOSI) and 13 (SCK), every transferred bit shows up on the pins in virtual time
+class SPISettings
+{
+public:
+  SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) : clock(clock), bitOrder(bitOrder), dataMode(dataMode) {}
+
+  uint32_t clock;
+  uint8_t bitOrder;
+  uint8_t dataMode;
+};
+
+class SPIClass
+{
+public:
+  void begin();
+  void end();
+  void beginTransaction(const SPISettings &settings);
+  void endTransaction();
+  uint8_t transfer(uint8_t data);
+
+private:
+  uint32_t clock = 4000000;
+  uint8_t bitOrder = MSBFIRST;
+};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef HOST_AVR_EEPROM_H
+#define HOST_AVR_EEPROM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// EEPROM addresses are pointers like on the MCU, cells are kept in hostEeprom (host.h)
+
+uint8_t eeprom_read_byte(const uint8_t *address);
+void eeprom_write_byte(uint8_t *address, uint8_t value);
+void eeprom_update_byte(uint8_t *address, uint8_t value);
+void eeprom_read_block(void *destination, const void *source, size_t size);
+void eeprom_write_block(const void *source, void *destination, size_t size);
+void eeprom_update_block(const void *source, void *destination, size_t size);
+
+// a byte write takes 3.4ms like on the MCU
+int eeprom_is_ready();
+
+#endif
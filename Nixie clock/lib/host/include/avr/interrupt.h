@@ -0,0 +1,20 @@
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+#include <avr/io.h>
+
+/*
+Interrupt handlers of the native build are plain functions, the interrupt model (host.h) calls them when
+their event is due, the handler is enabled and global interrupts are on.
+*/
+
+#define ISR(vector, ...) extern "C" void vector(void)
+#define EMPTY_INTERRUPT(vector) \
+  extern "C" void vector(void)  \
+  {                             \
+  }
+
+void cli();
+void sei();
+
+#endif
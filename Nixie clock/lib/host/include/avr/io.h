@@ -0,0 +1,95 @@
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+#include <stdint.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+/*
+ATmega328 registers of the native build. Port registers and TWCR are objects, so every write is seen by the pin
+and TWI models (host.h) and recorded, all other registers are plain variables that the interrupt model reads.
+*/
+
+// one of the PORTx, DDRx and PINx registers of a port
+class HostPortRegister
+{
+public:
+  enum Kind
+  {
+    PORT,
+    DDR,
+    PIN
+  };
+
+  HostPortRegister(uint8_t port, Kind kind) : port(port), kind(kind) {}
+
+  operator uint8_t() const;
+  HostPortRegister &operator=(uint8_t value);
+  // int operands, so "PORTB &= ~mask" works like on a real register
+  HostPortRegister &operator|=(int value) { return *this = *this | value; }
+  HostPortRegister &operator&=(int value) { return *this = *this & value; }
+  HostPortRegister &operator^=(int value) { return *this = *this ^ value; }
+
+private:
+  uint8_t port; // 0 is port B, 1 port C, 2 port D
+  Kind kind;
+};
+
+extern HostPortRegister PORTB, DDRB, PINB;
+extern HostPortRegister PORTC, DDRC, PINC;
+extern HostPortRegister PORTD, DDRD, PIND;
+
+// TWI control register, writing it starts the next bus event and reading it takes time, so polling loops end
+class HostTwiControl
+{
+public:
+  operator uint8_t() const;
+  HostTwiControl &operator=(uint8_t value);
+  HostTwiControl &operator|=(int value) { return *this = *this | value; }
+  HostTwiControl &operator&=(int value) { return *this = *this & value; }
+};
+
+extern HostTwiControl TWCR;
+
+extern volatile uint8_t SREG, MCUSR, SMCR, PRR;
+extern volatile uint8_t PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2, EICRA, EIMSK, EIFR;
+extern volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, OCR0B, TIMSK0, TIFR0;
+extern volatile uint8_t TCCR1A, TCCR1B, TCCR1C, TIMSK1, TIFR1;
+extern volatile uint16_t TCNT1, OCR1A, OCR1B;
+extern volatile uint8_t TCCR2A, TCCR2B, TCNT2, OCR2A, OCR2B, TIMSK2, TIFR2;
+extern volatile uint8_t ADCSRA;
+extern volatile uint8_t TWBR, TWSR, TWAR, TWDR;
+
+#define _BV(bit) (1 << (bit))
+
+enum { PB0, PB1, PB2, PB3, PB4, PB5, PB6, PB7 };
+enum { PC0, PC1, PC2, PC3, PC4, PC5, PC6 };
+enum { PD0, PD1, PD2, PD3, PD4, PD5, PD6, PD7 };
+
+enum { PCINT0, PCINT1, PCINT2, PCINT3, PCINT4, PCINT5, PCINT6, PCINT7 };
+enum { PCINT8, PCINT9, PCINT10, PCINT11, PCINT12, PCINT13, PCINT14 };
+enum { PCINT16 = 0, PCINT17, PCINT18, PCINT19, PCINT20, PCINT21, PCINT22, PCINT23 };
+enum { PCIE0, PCIE1, PCIE2 };
+enum { PCIF0, PCIF1, PCIF2 };
+
+enum { WGM00, WGM01, COM0B0 = 4, COM0B1, COM0A0, COM0A1 };
+enum { CS00, CS01, CS02, WGM02 };
+enum { TOIE0, OCIE0A, OCIE0B };
+enum { WGM10, WGM11, COM1B0 = 4, COM1B1, COM1A0, COM1A1 };
+enum { CS10, CS11, CS12, WGM12, WGM13 };
+enum { TOIE1, OCIE1A, OCIE1B };
+enum { TOV1, OCF1A, OCF1B };
+enum { WGM20, WGM21, COM2B0 = 4, COM2B1, COM2A0, COM2A1 };
+enum { CS20, CS21, CS22, WGM22 };
+enum { TOIE2, OCIE2A, OCIE2B };
+
+enum { ADPS0, ADPS1, ADPS2, ADIE, ADIF, ADATE, ADSC, ADEN };
+enum { PRADC, PRUSART0, PRSPI, PRTIM1, PRTIM0 = 5, PRTIM2, PRTWI };
+enum { TWIE, TWEN = 2, TWWC, TWSTO, TWSTA, TWEA, TWINT };
+enum { TWPS0, TWPS1 };
+
+#define SREG_I 7
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef HOST_AVR_SLEEP_H
+#define HOST_AVR_SLEEP_H
+
+#include <avr/io.h>
+
+#define SLEEP_MODE_IDLE 0
+#define SLEEP_MODE_PWR_DOWN 2
+
+void set_sleep_mode(uint8_t mode);
+void sleep_enable();
+void sleep_disable();
+void sleep_bod_disable();
+
+// virtual time runs until an interrupt wakes the MCU up (timers are stopped in power-down mode)
+void sleep_cpu();
+
+#endif
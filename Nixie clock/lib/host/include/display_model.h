@@ -0,0 +1,36 @@
+#ifndef DISPLAY_MODEL_H
+#define DISPLAY_MODEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Clock board as seen from the pins of the native build: the TPIC6B595 chain with the tubes and neons on its
+outputs, the high voltage supply (DisplayControl) and the indicator LEDs. It only looks at pin levels, so it
+shows what the hardware would show, whatever the firmware meant to do.
+*/
+
+// connects the model to the pins, has to be called before setup()
+void displayModelBegin();
+
+/**
+ * Reads the outputs of the chain, in the frame layout of shift_register.h
+ * @param frame frame_bytes long
+ */
+void displayModelFrame(uint8_t *frame);
+
+// returns true if the high voltage supply is on (at full brightness or through PWM)
+bool displayModelLit();
+
+// returns number of rising edges on the latch pin so far
+unsigned long displayModelLatches();
+
+/**
+ * Renders tubes, neons, supply and LEDs as text, like "12:34 lit  H-"
+ * (blank tube is a space, a tube with more than one cathode on is '#', a neon off is a space instead of ':')
+ * @param text where the text goes
+ * @param size size of text
+ */
+void displayModelText(char *text, size_t size);
+
+#endif
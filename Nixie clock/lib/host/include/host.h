@@ -0,0 +1,157 @@
+#ifndef HOST_H
+#define HOST_H
+
+#include <stdint.h>
+
+/*
+Control side of the native build, used by the host programs that run the clock.
+
+Virtual time is counted in nanoseconds and only moves when the clock code does something that takes time on
+the MCU (millis(), micros(), delays, port writes, SPI and serial transfers) or sleeps. Interrupts are run as
+soon as they are due and enabled: Timer0 compare match every 1.024ms, Timer2 overflow and compare match, pin
+change interrupts and whatever the DS3231 model and scheduled actions do. Timers stop in power-down sleep and
+millis() counts only awake time, like on the MCU.
+
+Pins use Arduino numbering. Every change of a pin level is passed to the pin listeners with its virtual time,
+external devices (buttons, PIR sensor, square wave) drive input pins with hostDrivePin()/hostReleasePin().
+*/
+
+const uint64_t host_nanoseconds_per_second = 1000000000ULL;
+const uint8_t host_pin_count = 20;
+const int host_eeprom_size = 1024;
+
+// virtual time since start (in nanoseconds)
+uint64_t hostNanos();
+
+// virtual time the MCU has been awake (in nanoseconds)
+uint64_t hostAwakeNanos();
+
+/**
+ * Moves virtual time forward, due events and interrupts are run on the way
+ * @param nanoseconds how long
+ */
+void hostAdvance(uint64_t nanoseconds);
+
+/**
+ * Moves virtual time to the next event: a scheduled action, a pin change or TWI interrupt or, if asked for,
+ * a timer interrupt. Interrupts are run on the way. Used to skip loop() calls that would only poll.
+ * @param timers true if timer interrupts are events as well
+ * @param limit virtual time where to stop anyway (in nanoseconds)
+ */
+void hostRunToNextEvent(bool timers, uint64_t limit);
+
+// returns number of port, EEPROM, serial and RTC accesses outside interrupts so far
+unsigned long hostActivity();
+
+/**
+ * Runs an action at a virtual time, actions with the same time run in the order they were scheduled
+ * @param time virtual time (in nanoseconds)
+ * @param action function to be called
+ * @param argument passed to the action
+ */
+void hostAt(uint64_t time, void (*action)(long), long argument);
+
+/**
+ * Sets the end of the run, sleep never goes past it and hostFinished() becomes true there
+ * @param time end of the run (in nanoseconds)
+ */
+void hostSetEndTime(uint64_t time);
+
+// returns true when the end time has been reached
+bool hostFinished();
+
+// returns true while the MCU sleeps
+bool hostSleeping();
+
+// returns number of times the MCU has gone to sleep
+unsigned long hostSleeps();
+
+/**
+ * Drives an input pin from outside
+ * @param pin Arduino pin number
+ * @param level HIGH or LOW
+ */
+void hostDrivePin(uint8_t pin, bool level);
+
+/**
+ * Stops driving a pin, it is pulled up if the pullup is on and reads LOW otherwise
+ * @param pin Arduino pin number
+ */
+void hostReleasePin(uint8_t pin);
+
+// returns level of a pin, as seen from outside
+bool hostPinLevel(uint8_t pin);
+
+// returns true if the pin is an output
+bool hostPinIsOutput(uint8_t pin);
+
+/**
+ * Adds a pin listener, it is called after every change of a pin level (hostNanos() is the time of the change)
+ * @param listener function called with the pin and its new level
+ */
+void hostOnPinChange(void (*listener)(uint8_t pin, bool level));
+
+/**
+ * Receives bytes on the serial port, the RX pin changes as well so a sleeping MCU wakes up
+ * @param data received bytes
+ * @param length number of bytes
+ */
+void hostSerialInput(const uint8_t *data, int length);
+
+/**
+ * Adds a serial listener, it gets every transmitted byte
+ * @param listener function called with every byte
+ */
+void hostOnSerialOutput(void (*listener)(uint8_t data));
+
+// EEPROM cells, erased (0xFF) at start
+extern uint8_t hostEeprom[host_eeprom_size];
+
+/**
+ * Sets date and time of the simulated DS3231
+ * @param seconds seconds since 2000-01-01 00:00:00
+ */
+void hostRtcSet(uint32_t seconds);
+
+// returns date and time of the simulated DS3231 in seconds since 2000-01-01 00:00:00
+uint32_t hostRtcSeconds();
+
+/**
+ * Makes the simulated DS3231 run fast or slow
+ * @param ppm frequency error of the crystal (in parts per million, positive is fast)
+ */
+void hostRtcSetDrift(double ppm);
+
+/**
+ * Sets how much one step of the aging offset register changes the frequency of the simulated DS3231
+ * @param ppm change per step (in parts per million, positive steps slow the RTC down), ds3231_aging_step_ppm at start
+ */
+void hostRtcSetAgingStep(double ppm);
+
+// returns the aging offset register of the simulated DS3231
+int8_t hostRtcAgingOffset();
+
+/**
+ * Connects the square wave output of the DS3231 to a pin (A0 unless changed)
+ * @param pin Arduino pin number
+ */
+void hostRtcConnectSquareWave(uint8_t pin);
+
+// returns number of I2C transactions with the DS3231 so far
+unsigned long hostRtcTransactions();
+
+// faults of the I2C bus to the DS3231
+enum HostI2cFault
+{
+  HOST_I2C_OK,
+  HOST_I2C_NO_ANSWER, // DS3231 doesn't acknowledge its address (loose wire)
+  HOST_I2C_STUCK      // bus events never finish, the TWI interrupt never comes (SDA held low)
+};
+
+/**
+ * Breaks or repairs the I2C bus to the DS3231, bus events that are running when it breaks don't finish
+ * @param fault what is wrong with the bus from now on
+ */
+void hostI2cFault(HostI2cFault fault);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef HOST_UTIL_ATOMIC_H
+#define HOST_UTIL_ATOMIC_H
+
+#include <avr/interrupt.h>
+
+// interrupts are turned off for the block and SREG is restored when it is left (also with return)
+struct HostAtomicBlock
+{
+  uint8_t sreg;
+
+  HostAtomicBlock() : sreg(SREG) { cli(); }
+  ~HostAtomicBlock() { SREG = sreg; }
+};
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+#define ATOMIC_BLOCK(type) for (HostAtomicBlock hostAtomicBlock, *hostAtomicOnce = &hostAtomicBlock; hostAtomicOnce; hostAtomicOnce = 0)
+
+#endif
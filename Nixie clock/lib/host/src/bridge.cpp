@@ -0,0 +1,111 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <deque>
+#include <random>
+#include <vector>
+#include "bridge.h"
+#include "host.h"
+#include "pins.h"
+
+/*
+Bytes the clock sends are collected until a read takes them, written bytes are kept until their latency has
+passed. The clock only runs while a read or wait command waits for something, so virtual time stands still
+while nixie.py works out what to send next, like a host that is infinitely fast.
+*/
+
+const int max_line = 512;
+
+static std::deque<uint8_t> sent;                 // bytes the clock sent that weren't read yet
+static std::deque<std::vector<uint8_t>> pending; // written bytes that haven't reached the RX pin yet
+static std::mt19937 generator;
+
+static void collect(uint8_t data)
+{
+  sent.push_back(data);
+}
+
+static void deliver(long)
+{
+  hostSerialInput(pending.front().data(), pending.front().size());
+  pending.pop_front();
+}
+
+// runs loop() until the given time or until count bytes were sent, a sleeping clock wakes up at that time
+static void runUntil(uint64_t time, size_t count)
+{
+  hostSetEndTime(time);
+  while (sent.size() < count && !hostFinished())
+  {
+    unsigned long sleeps = hostSleeps();
+
+    loop();
+    if (hostSleeps() == sleeps && sent.size() < count)
+      hostRunToNextEvent(true, time);
+  }
+  hostSetEndTime(UINT64_MAX);
+}
+
+// parses hex bytes, returns false if there is anything else
+static bool parseBytes(const char *text, std::vector<uint8_t> &bytes)
+{
+  unsigned value;
+  int length;
+
+  while (sscanf(text, " %2x%n", &value, &length) == 1)
+  {
+    bytes.push_back(value);
+    text += length;
+  }
+  return text[strspn(text, " \t\r\n")] == 0;
+}
+
+int bridge(uint32_t start, double drift, double agingStep, double jitter, unsigned seed)
+{
+  std::uniform_real_distribution<double> latency(0, jitter * 1000);
+  char line[max_line];
+
+  generator.seed(seed);
+  hostOnSerialOutput(collect);
+  hostRtcSet(start);
+  hostRtcSetDrift(drift);
+  hostRtcSetAgingStep(agingStep);
+  hostDrivePin(Board::Sensor::number, LOW); // PIR output, no motion
+  sei(); // done by the Arduino core before setup()
+  setup();
+
+  while (fgets(line, sizeof(line), stdin))
+  {
+    unsigned long long time;
+    unsigned count;
+    int length;
+    std::vector<uint8_t> bytes;
+
+    if (strncmp(line, "write ", 6) == 0 && parseBytes(line + 6, bytes) && !bytes.empty())
+    {
+      pending.push_back(bytes);
+      hostAt(hostNanos() + (uint64_t)latency(generator), deliver, 0);
+      bytes.clear();
+    }
+    else if (sscanf(line, "read %u %llu %n", &count, &time, &length) == 2 && line[length] == 0)
+    {
+      runUntil(hostNanos() + time, count);
+      count = min((size_t)count, sent.size());
+      bytes.assign(sent.begin(), sent.begin() + count);
+      sent.erase(sent.begin(), sent.begin() + count);
+    }
+    else if (sscanf(line, "wait %llu %n", &time, &length) == 1 && line[length] == 0)
+      runUntil(time, SIZE_MAX);
+    else
+    {
+      fprintf(stderr, "bridge: bad command: %s", line);
+      return 2;
+    }
+
+    printf("%llu", (unsigned long long)hostNanos());
+    for (uint8_t data : bytes)
+      printf(" %02x", data);
+    printf("\n");
+    fflush(stdout);
+  }
+  return 0;
+}
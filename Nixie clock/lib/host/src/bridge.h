@@ -0,0 +1,33 @@
+#ifndef BRIDGE_H
+#define BRIDGE_H
+
+#include <Arduino.h>
+
+/*
+Serial bridge of the native build: tools/nixie.py talks to the simulated clock over stdin and stdout instead
+of a serial port (port sim:program --bridge ...), with the virtual time of the simulator as its reference
+clock, so its calibration runs against a DS3231 whose crystal is off by a given drift and whose aging offset
+doesn't change the frequency by exactly the step nixie.py assumes. tools/calibration_check.py does that and
+checks the results.
+
+  program --bridge [--drift ppm] [--aging-step ppm] [--jitter us] [--seed n]
+
+Every line on stdin is a command and gets one line on stdout, times are virtual nanoseconds:
+  write <hex bytes>         - bytes reach the RX pin after a random latency of 0...jitter, answer: time
+  read <count> <timeout>    - runs the clock until count bytes were sent or for timeout, answer: time and the
+                              hex bytes that were sent (fewer than count after a timeout)
+  wait <time>               - runs the clock until the given time, answer: time
+*/
+
+/**
+ * Runs the clock and the bridge until stdin ends
+ * @param start date and time of the RTC at start (seconds since 2000-01-01 00:00:00)
+ * @param drift frequency error of the simulated crystal (in parts per million, positive is fast)
+ * @param agingStep frequency change per aging offset step of the simulated DS3231 (in parts per million)
+ * @param jitter longest latency of written bytes, like a USB serial adapter (in microseconds)
+ * @param seed seed of the random latency
+ * @return exit code of the program
+ */
+int bridge(uint32_t start, double drift, double agingStep, double jitter, unsigned seed);
+
+#endif
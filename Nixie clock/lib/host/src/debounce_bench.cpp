@@ -0,0 +1,445 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "buttons.h"
+#include "debounce_bench.h"
+#include "pins.h"
+
+/*
+Waveforms are lists of the times (in microseconds) at which the contact opens or closes, it is open (released)
+at the start. Every strategy samples the waveform at its own sample period with a random phase, like buttons
+that are pressed at any time relative to the system tick. A press is detected in time if it is reported between
+the first closing of the contact and release_slack after the last opening, the first report counts and every
+other report is false.
+*/
+
+const uint32_t tick = 1024; // system tick (in microseconds)
+const uint32_t release_slack = 100000;
+const uint32_t idle_tail = 600000; // waveform goes on after the last edge so slow strategies can finish
+const int cost_samples = 1 << 20;
+const int cost_repeats = 8;
+
+struct Press
+{
+  uint32_t start;
+  uint32_t end;
+};
+
+struct Waveform
+{
+  std::vector<uint32_t> edges; // contact changes, the first one closes it
+  std::vector<Press> presses;  // presses the user made
+  uint32_t length;
+};
+
+struct Strategy
+{
+  const char *name;
+  uint32_t period; // time between samples (in microseconds)
+  int stateBits;   // RAM used per button on the MCU
+  void (*reset)();
+  bool (*sample)(bool pressed, uint32_t now); // returns true when a press is recognized
+};
+
+struct Pattern
+{
+  const char *name;
+  void (*generate)(Waveform &waveform);
+};
+
+struct Result
+{
+  unsigned long presses = 0;
+  unsigned long missed = 0;
+  unsigned long falsePresses = 0;
+  std::vector<double> latencies; // milliseconds
+};
+
+static std::mt19937 generator;
+
+static uint32_t uniform(uint32_t from, uint32_t to)
+{
+  return std::uniform_int_distribution<uint32_t>(from, to)(generator);
+}
+
+static double uniformReal(double from, double to)
+{
+  return std::uniform_real_distribution<double>(from, to)(generator);
+}
+
+// strategies ---------------------------------------------------------------------------------------------------
+
+// the firmware: vertical counters, 4 equal samples every 10 ticks
+static void verticalReset()
+{
+  for (int i = 0; i < 4; i++)
+    debounceButtons(0);
+  buttonPresses();
+  buttonReleases();
+}
+
+static bool verticalSample(bool pressed, uint32_t)
+{
+  debounceButtons(pressed);
+  return buttonPresses() & 1;
+}
+
+// debouncedButtonRead() of the testing sketches: state changes once the reading has been stable for 50ms
+const uint32_t restart_delay = 50000;
+static bool restartReading, restartState;
+static uint32_t restartTime;
+
+static void restartReset()
+{
+  restartReading = restartState = false;
+  restartTime = 0;
+}
+
+static bool restartSample(bool pressed, uint32_t now)
+{
+  bool press = false;
+
+  if (pressed != restartReading)
+    restartTime = now;
+  if (now - restartTime > restart_delay && pressed != restartState)
+  {
+    restartState = pressed;
+    press = pressed;
+  }
+  restartReading = pressed;
+  return press;
+}
+
+// integrator: counts up while pressed and down while released, state changes at the ends
+const uint8_t integrator_top = 8;
+static uint8_t integrator;
+static bool integratorState;
+
+static void integratorReset()
+{
+  integrator = 0;
+  integratorState = false;
+}
+
+static bool integratorSample(bool pressed, uint32_t)
+{
+  if (pressed && integrator < integrator_top)
+    integrator++;
+  else if (!pressed && integrator > 0)
+    integrator--;
+
+  bool changed = (integrator == integrator_top && !integratorState) || (integrator == 0 && integratorState);
+
+  if (changed)
+    integratorState = !integratorState;
+  return changed && integratorState;
+}
+
+// shift pattern: a press is two released samples followed by three pressed ones, history is refilled after it
+static uint8_t history;
+
+static void historyReset()
+{
+  history = 0;
+}
+
+static bool historySample(bool pressed, uint32_t)
+{
+  history = history << 1 | pressed;
+  if ((history & 0b11000111) == 0b00000111)
+  {
+    history = 0xFF;
+    return true;
+  }
+  return false;
+}
+
+// lockout: the first edge is taken right away, then the contact is ignored for 50ms
+const uint32_t lockout_time = 50000;
+static bool lockoutState;
+static uint32_t lockoutEnd;
+
+static void lockoutReset()
+{
+  lockoutState = false;
+  lockoutEnd = 0;
+}
+
+static bool lockoutSample(bool pressed, uint32_t now)
+{
+  if ((int32_t)(now - lockoutEnd) < 0 || pressed == lockoutState)
+    return false;
+
+  lockoutState = pressed;
+  lockoutEnd = now + lockout_time;
+  return pressed;
+}
+
+static const Strategy strategies[] = {
+    {"vertical counter 4x10 ticks", 10 * tick, 5, verticalReset, verticalSample},
+    {"restart timer 50ms", tick, 64, restartReset, restartSample},
+    {"integrator 8x5 ticks", 5 * tick, 5, integratorReset, integratorSample},
+    {"shift pattern 5 ticks", 5 * tick, 8, historyReset, historySample},
+    {"lockout 50ms", tick, 17, lockoutReset, lockoutSample},
+};
+
+const int strategy_count = sizeof(strategies) / sizeof(strategies[0]);
+
+// waveforms ----------------------------------------------------------------------------------------------------
+
+// adds a contact change at time with bounce (pairs of extra changes) for up to window microseconds after it
+static uint32_t addBounce(Waveform &waveform, uint32_t time, uint32_t window, int maxPairs)
+{
+  int pairs = window ? uniform(0, maxPairs) : 0;
+  std::vector<uint32_t> bounces;
+
+  for (int i = 0; i < 2 * pairs; i++)
+    bounces.push_back(time + uniform(1, window));
+  std::sort(bounces.begin(), bounces.end());
+  bounces.erase(std::unique(bounces.begin(), bounces.end()), bounces.end());
+  if (bounces.size() % 2)
+    bounces.pop_back();
+
+  waveform.edges.push_back(time);
+  waveform.edges.insert(waveform.edges.end(), bounces.begin(), bounces.end());
+  return waveform.edges.back();
+}
+
+// adds a press held for hold microseconds, both edges bounce for up to bounce microseconds
+static void addPress(Waveform &waveform, uint32_t start, uint32_t hold, uint32_t bounce)
+{
+  addBounce(waveform, start, bounce, 20);
+  uint32_t end = addBounce(waveform, start + hold, bounce, 20);
+
+  waveform.presses.push_back({start, end});
+  waveform.length = end + idle_tail;
+}
+
+/**
+ * Adds a slow edge: the input voltage moves linearly across the threshold during ramp microseconds while noise
+ * is added to it, the contact ends up in the changed state
+ * @param closing true if the contact closes (input falls)
+ * @return time of the first change
+ */
+static uint32_t addSlowEdge(Waveform &waveform, uint32_t start, uint32_t ramp, bool closing)
+{
+  const uint32_t step = 50;
+  bool closed = !closing;
+  uint32_t first = 0;
+
+  for (uint32_t t = 0; t <= ramp; t += step)
+  {
+    double level = closing ? 1.0 - (double)t / ramp : (double)t / ramp;
+    bool reading = level + uniformReal(-0.2, 0.2) < 0.5;
+
+    if (reading != closed)
+    {
+      if (!first)
+        first = start + t;
+      waveform.edges.push_back(start + t);
+      closed = reading;
+    }
+  }
+  if (closed != closing)
+    waveform.edges.push_back(start + ramp + step);
+  return first ? first : start + ramp + step;
+}
+
+static void cleanPattern(Waveform &waveform)
+{
+  addPress(waveform, uniform(100000, 300000), uniform(80000, 300000), 0);
+}
+
+static void chatterPattern(Waveform &waveform)
+{
+  addPress(waveform, uniform(100000, 300000), uniform(80000, 300000), uniform(500, 15000));
+}
+
+static void tapPattern(Waveform &waveform)
+{
+  addPress(waveform, uniform(100000, 300000), uniform(30000, 70000), uniform(500, 5000));
+}
+
+static void glitchPattern(Waveform &waveform)
+{
+  uint32_t time = 0;
+  int count = uniform(1, 20);
+
+  for (int i = 0; i < count; i++)
+  {
+    time += uniform(10000, 200000);
+    waveform.edges.push_back(time);
+    time += uniform(2, 3000);
+    waveform.edges.push_back(time);
+  }
+  waveform.length = time + idle_tail;
+}
+
+static void slowPattern(Waveform &waveform)
+{
+  uint32_t start = addSlowEdge(waveform, uniform(100000, 300000), uniform(5000, 40000), true);
+  addSlowEdge(waveform, waveform.edges.back() + uniform(100000, 300000), uniform(5000, 40000), false);
+  waveform.presses.push_back({start, waveform.edges.back()});
+  waveform.length = waveform.edges.back() + idle_tail;
+}
+
+static void stuckPattern(Waveform &waveform)
+{
+  uint32_t start = uniform(100000, 300000);
+  uint32_t end = start + uniform(2000000, 8000000);
+  bool released = uniform(0, 1);
+  uint32_t time = addBounce(waveform, start, uniform(500, 15000), 20);
+
+  // dirty contact: opens for a moment every now and then
+  while ((time += uniform(50000, 500000)) < end)
+  {
+    waveform.edges.push_back(time);
+    time += uniform(20, 4000);
+    waveform.edges.push_back(time);
+  }
+  if (released)
+    end = addBounce(waveform, end, uniform(500, 15000), 20);
+  waveform.presses.push_back({start, end});
+  waveform.length = end + idle_tail;
+}
+
+static const Pattern patterns[] = {
+    {"clean", cleanPattern},   {"chatter", chatterPattern}, {"taps", tapPattern},
+    {"glitches", glitchPattern}, {"slow", slowPattern},     {"stuck", stuckPattern},
+};
+
+// benchmark ----------------------------------------------------------------------------------------------------
+
+// returns press times reported by a strategy for a waveform, samples start at phase
+static std::vector<uint32_t> detect(const Strategy &strategy, const Waveform &waveform, uint32_t phase)
+{
+  std::vector<uint32_t> reports;
+  size_t edge = 0;
+
+  strategy.reset();
+  for (uint32_t now = phase; now < waveform.length; now += strategy.period)
+  {
+    while (edge < waveform.edges.size() && waveform.edges[edge] <= now)
+      edge++;
+    if (strategy.sample(edge % 2, now))
+      reports.push_back(now);
+  }
+  return reports;
+}
+
+static void score(const Waveform &waveform, const std::vector<uint32_t> &reports, Result &result)
+{
+  std::vector<bool> found(waveform.presses.size());
+
+  result.presses += waveform.presses.size();
+  for (uint32_t report : reports)
+  {
+    bool matched = false;
+
+    for (size_t i = 0; i < waveform.presses.size() && !matched; i++)
+    {
+      const Press &press = waveform.presses[i];
+
+      if (!found[i] && report >= press.start && report <= press.end + release_slack)
+      {
+        found[i] = matched = true;
+        result.latencies.push_back((report - press.start) / 1000.0);
+      }
+    }
+    if (!matched)
+      result.falsePresses++;
+  }
+  result.missed += std::count(found.begin(), found.end(), false);
+}
+
+static double percentile(const std::vector<double> &sorted, double fraction)
+{
+  return sorted[std::min(sorted.size() - 1, (size_t)(fraction * sorted.size()))];
+}
+
+static void printResult(const char *pattern, const Strategy &strategy, Result &result)
+{
+  printf("%-9s %-28s %7lu %7lu %7lu", pattern, strategy.name, result.presses,
+         result.presses - result.missed, result.missed);
+  printf(" %7lu", result.falsePresses);
+  if (result.latencies.empty())
+  {
+    printf("\n");
+    return;
+  }
+  std::sort(result.latencies.begin(), result.latencies.end());
+  printf("   %6.1f %6.1f %6.1f %6.1f\n", result.latencies.front(), percentile(result.latencies, 0.5),
+         percentile(result.latencies, 0.95), result.latencies.back());
+}
+
+// returns host nanoseconds per sample on a chattering input (relative figures, the MCU is much slower)
+static double sampleCost(const Strategy &strategy)
+{
+  std::vector<uint8_t> samples(cost_samples);
+  bool pressed = false;
+  unsigned long presses = 0;
+
+  for (int i = 0; i < cost_samples; i++)
+  {
+    if (uniform(0, 19) == 0)
+      pressed = !pressed;
+    samples[i] = pressed ^ (uniform(0, 9) == 0);
+  }
+
+  strategy.reset();
+  auto start = std::chrono::steady_clock::now();
+  uint32_t now = 0;
+
+  for (int repeat = 0; repeat < cost_repeats; repeat++)
+  {
+    for (int i = 0; i < cost_samples; i++, now += strategy.period)
+      presses += strategy.sample(samples[i], now);
+  }
+
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+  if (presses == 0)
+    printf("%s never reported a press\n", strategy.name);
+  return elapsed.count() / ((double)cost_samples * cost_repeats);
+}
+
+int debounceBench(int runs, unsigned seed)
+{
+  bool firmwareFalse = false;
+
+  generator.seed(seed);
+  buttonsBegin(10);
+  printf("%d runs per pattern, seed %u, latency in ms from the first contact\n\n", runs, seed);
+  printf("%-9s %-28s %7s %7s %7s %7s   %6s %6s %6s %6s\n", "pattern", "strategy", "presses", "found", "missed",
+         "false", "min", "median", "p95", "max");
+
+  for (const Pattern &pattern : patterns)
+  {
+    Result results[strategy_count];
+
+    for (int run = 0; run < runs; run++)
+    {
+      Waveform waveform;
+      double phase = uniformReal(0, 1);
+
+      pattern.generate(waveform);
+      for (int i = 0; i < strategy_count; i++)
+        score(waveform, detect(strategies[i], waveform, phase * strategies[i].period), results[i]);
+    }
+    for (int i = 0; i < strategy_count; i++)
+      printResult(pattern.name, strategies[i], results[i]);
+    firmwareFalse |= results[0].falsePresses > 0;
+    printf("\n");
+  }
+
+  printf("%-28s %9s %9s %10s\n", "strategy", "sample", "ns/sample", "bits/button");
+  for (const Strategy &strategy : strategies)
+    printf("%-28s %7.2fms %9.2f %10d\n", strategy.name, strategy.period / 1000.0, sampleCost(strategy),
+           strategy.stateBits);
+  printf("\nvertical counters debounce all %d buttons in one sample\n", number_of_buttons);
+
+  return firmwareFalse ? 1 : 0;
+}
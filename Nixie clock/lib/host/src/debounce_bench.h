@@ -0,0 +1,29 @@
+#ifndef DEBOUNCE_BENCH_H
+#define DEBOUNCE_BENCH_H
+
+/*
+Debounce benchmark of the native build: feeds generated contact waveforms into several debouncing strategies,
+the firmware's vertical counters (debounceButtons() in buttons.h) among them, and reports for every waveform
+pattern how many presses were detected, missed and falsely reported, the press detection latency and the
+cost of a sample on the host.
+
+  program --debounce-bench [--runs n] [--seed n]
+
+Patterns (one press per run unless noted):
+  clean    - no bounce at all
+  chatter  - random contact bounce of up to 15ms on press and release
+  taps     - short presses of 30 to 70ms with bounce
+  glitches - no press, spikes of 2us to 3ms on the idle line
+  slow     - slow edges (5 to 40ms) through the input threshold with noise
+  stuck    - contact held for seconds with short dropouts, half of the runs never release
+*/
+
+/**
+ * Runs the benchmark and prints the report
+ * @param runs waveforms generated per pattern
+ * @param seed seed of the random generator, the same seed gives the same waveforms
+ * @return exit code of the program, 1 if the firmware reported a press that didn't happen
+ */
+int debounceBench(int runs, unsigned seed);
+
+#endif
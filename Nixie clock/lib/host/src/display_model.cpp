@@ -0,0 +1,108 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include "display.h"
+#include "display_model.h"
+#include "host.h"
+#include "pins.h"
+
+// the chain shifts on SRCK, which is on the SCK pin when the SPI backend is used
+#if SHIFT_BACKEND == SHIFT_BACKEND_SPI
+const uint8_t clock_pin = 13;
+#else
+const uint8_t clock_pin = Board::Clock::number;
+#endif
+
+const int chain_bits = frame_bytes * 8;
+
+// stage k of the chain is k clocks away from the data input, the last stage holds the frame bit shifted out first
+static uint8_t stages[frame_bytes];
+static uint8_t outputs[frame_bytes];
+static unsigned long latches = 0;
+
+static bool stage(const uint8_t *chain, int k)
+{
+  return chain[k / 8] & (1 << (k % 8));
+}
+
+static void pinChanged(uint8_t pin, bool level)
+{
+  if (pin == Board::MasterReset::number && !level)
+    memset(stages, 0, sizeof(stages)); // SRCLR clears the shift registers, outputs are kept
+  else if (pin == clock_pin && level && hostPinLevel(Board::MasterReset::number))
+  {
+    for (int i = frame_bytes - 1; i > 0; i--)
+      stages[i] = stages[i] << 1 | stages[i - 1] >> 7;
+    stages[0] = stages[0] << 1 | hostPinLevel(Board::Data::number);
+  }
+  else if (pin == Board::Latch::number && level)
+  {
+    memcpy(outputs, stages, sizeof(outputs));
+    latches++;
+  }
+}
+
+void displayModelBegin()
+{
+  hostOnPinChange(pinChanged);
+}
+
+void displayModelFrame(uint8_t *frame)
+{
+  memset(frame, 0, frame_bytes);
+  for (int i = 0; i < chain_bits; i++)
+  {
+    if (stage(outputs, chain_bits - 1 - i))
+      frame[i / 8] |= 1 << (i % 8);
+  }
+}
+
+bool displayModelLit()
+{
+  return hostPinLevel(Board::DisplayControl::number) || (TIMSK2 & (_BV(TOIE2) | _BV(OCIE2A)));
+}
+
+unsigned long displayModelLatches()
+{
+  return latches;
+}
+
+// returns the digit shown by a tube, ' ' if it is blank and '#' if more than one cathode is on
+static char tubeDigit(const uint8_t *frame, int tube)
+{
+  char digit = ' ';
+
+  for (int d = 0; d < 10; d++)
+  {
+    int n = (tube_count - 1 - tube) * 10 + d;
+
+    if (frame[n / 8] & (1 << (n % 8)))
+      digit = digit == ' ' ? '0' + d : '#';
+  }
+  return digit;
+}
+
+void displayModelText(char *text, size_t size)
+{
+  uint8_t frame[frame_bytes];
+  char tubes[3 * 6];
+  bool neons = neon_count == 0;
+  int length = 0;
+
+  displayModelFrame(frame);
+  for (int i = 0; i < neon_count; i++)
+  {
+    int n = tube_count * 10 + i;
+
+    neons |= frame[n / 8] & (1 << (n % 8));
+  }
+  for (int i = 0; i < tube_count; i++)
+  {
+    if (i > 0 && i % 2 == 0)
+      tubes[length++] = neons ? ':' : ' ';
+    tubes[length++] = tubeDigit(frame, i);
+  }
+  tubes[length] = 0;
+
+  snprintf(text, size, "%s %-4s %c%c", tubes, displayModelLit() ? "lit" : "dark",
+           hostPinLevel(Board::HourLed::number) ? 'H' : '-', hostPinLevel(Board::MinuteLed::number) ? 'M' : '-');
+}
@@ -0,0 +1,310 @@
+#include <Arduino.h>
+#include "ds3231.h"
+#include "host.h"
+#include "host_internal.h"
+
+/*
+Simulated DS3231 of the native build, src/ds3231.cpp talks to its registers over the simulated TWI bus.
+
+The RTC counts from the moment it was last set, its crystal may be off by some ppm, which the aging offset
+register corrects by its own sensitivity per step (right away, the DS3231 waits for a temperature conversion).
+The sensitivity is ds3231_aging_step_ppm unless it is changed, like on a real module it is only about that.
+Writing the seconds register resets the countdown chain, the written time counts from there once the transfer
+ends. The time registers are copied to a buffer at every start condition, so a burst read is consistent.
+With INTCN cleared the square wave output gives 1Hz (the rate select bits are ignored): it is open drain,
+driven low for the first half of every RTC second and released (pulled up) for the second half.
+*/
+
+const uint64_t half_second = host_nanoseconds_per_second / 2;
+const uint32_t seconds_per_day = 86400UL;
+const uint8_t register_count = 0x13;
+const uint8_t control_register = 0x0E;
+const uint8_t status_register = 0x0F;
+const uint8_t aging_offset_register = 0x10;
+const uint8_t temperature_register = 0x11;
+const uint8_t INTCN = 2, CONV = 5, OSF = 7;
+
+static uint32_t setSeconds = 0;   // date and time when the RTC was set
+static uint64_t setTime = 0;      // virtual time when the RTC was set
+static double frequencyError = 0; // relative
+static double crystalPpm = 0;     // frequency error without aging offset
+static int8_t agingOffset = 0;
+static double agingStepPpm = ds3231_aging_step_ppm; // true frequency change per aging offset step
+static uint8_t squareWavePin = A0;
+static bool squareWaveOn = false;
+static uint64_t nextHalfSecond = 0; // number of the half second at which the square wave changes next
+static long squareWaveGeneration = 0;
+static unsigned long transactions = 0;
+
+// registers after power up: 2000-01-01, square wave off and oscillator stop flag set, 25 degrees Celsius
+static uint8_t registers[register_count] = {0x00, 0x00, 0x00, 0x06, 0x01, 0x01, 0x00, 0, 0, 0, 0, 0, 0, 0,
+                                            0x1C, 0x88, 0x00, 25, 0x00};
+static uint8_t pointer = 0;      // register address
+static bool pointerNext = false; // next written byte is the register address
+static bool timeWritten = false; // time registers have been written in this transfer
+static bool secondsWritten = false;
+static uint64_t chainReset = 0; // virtual time of the seconds write
+
+// returns RTC nanoseconds since it was set
+static uint64_t rtcNanos()
+{
+  return (uint64_t)((hostNanos() - setTime) * (1 + frequencyError));
+}
+
+// returns virtual time at which the RTC has counted given nanoseconds since it was set
+static uint64_t virtualTime(uint64_t rtcTime)
+{
+  return setTime + (uint64_t)ceil(rtcTime / (1 + frequencyError));
+}
+
+static void squareWaveEdge(long generation);
+
+static void scheduleSquareWave()
+{
+  hostAt(virtualTime(nextHalfSecond * half_second), squareWaveEdge, squareWaveGeneration);
+}
+
+static void squareWaveEdge(long generation)
+{
+  if (generation != squareWaveGeneration)
+    return; // RTC has been set since
+
+  if (nextHalfSecond % 2 == 0)
+    hostDrivePin(squareWavePin, LOW);
+  else
+    hostReleasePin(squareWavePin);
+  nextHalfSecond++;
+  scheduleSquareWave();
+}
+
+// restarts the square wave at the current position of the countdown chain
+static void restartSquareWave()
+{
+  squareWaveGeneration++;
+  if (!squareWaveOn)
+  {
+    hostReleasePin(squareWavePin);
+    return;
+  }
+
+  uint64_t halfSeconds = rtcNanos() / half_second;
+
+  if (halfSeconds % 2 == 0)
+    hostDrivePin(squareWavePin, LOW);
+  else
+    hostReleasePin(squareWavePin);
+  nextHalfSecond = halfSeconds + 1;
+  scheduleSquareWave();
+}
+
+// days since 2000-01-01 of a date (Gregorian calendar)
+static uint32_t daysFromDate(int year, int month, int day)
+{
+  year -= month <= 2;
+  int era = year / 400;
+  int yearOfEra = year - era * 400;
+  int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+
+  return era * 146097 + dayOfEra - 730425; // 730425 is 2000-01-01 counted from 0000-03-01
+}
+
+static void dateFromDays(uint32_t days, RtcTime &time)
+{
+  long shifted = days + 730425;
+  long era = shifted / 146097;
+  long dayOfEra = shifted - era * 146097;
+  long yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+  long dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+  long monthIndex = (5 * dayOfYear + 2) / 153;
+
+  time.day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+  time.month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+  time.year = yearOfEra + era * 400 + (time.month <= 2);
+}
+
+void hostRtcSet(uint32_t seconds)
+{
+  setSeconds = seconds;
+  setTime = hostNanos();
+  restartSquareWave();
+}
+
+uint32_t hostRtcSeconds()
+{
+  return setSeconds + rtcNanos() / host_nanoseconds_per_second;
+}
+
+// keeps the current time and counts with the crystal and aging offset from now on
+static void updateFrequency()
+{
+  uint64_t counted = rtcNanos();
+  double ppm = crystalPpm - agingOffset * agingStepPpm;
+
+  setSeconds += counted / host_nanoseconds_per_second;
+  setTime = hostNanos() - (uint64_t)((counted % host_nanoseconds_per_second) / (1 + ppm / 1e6));
+  frequencyError = ppm / 1e6;
+  restartSquareWave();
+}
+
+void hostRtcSetDrift(double ppm)
+{
+  crystalPpm = ppm;
+  updateFrequency();
+}
+
+void hostRtcSetAgingStep(double ppm)
+{
+  agingStepPpm = ppm;
+  updateFrequency();
+}
+
+int8_t hostRtcAgingOffset()
+{
+  return agingOffset;
+}
+
+void hostRtcConnectSquareWave(uint8_t pin)
+{
+  hostReleasePin(squareWavePin);
+  squareWavePin = pin;
+  restartSquareWave();
+}
+
+unsigned long hostRtcTransactions()
+{
+  return transactions;
+}
+
+static uint8_t toBcd(uint8_t value)
+{
+  return (value / 10) << 4 | value % 10;
+}
+
+static uint8_t fromBcd(uint8_t value)
+{
+  return (value >> 4) * 10 + (value & 0x0F);
+}
+
+// copies the counted time to the time registers
+static void copyTime()
+{
+  uint32_t seconds = hostRtcSeconds();
+  uint32_t days = seconds / seconds_per_day;
+  uint32_t secondOfDay = seconds % seconds_per_day;
+  RtcTime date;
+
+  dateFromDays(days, date);
+  registers[0] = toBcd(secondOfDay % 60);
+  registers[1] = toBcd(secondOfDay / 60 % 60);
+  registers[2] = toBcd(secondOfDay / 3600);
+  registers[3] = (days + 5) % 7 + 1; // 2000-01-01 was a Saturday, Monday is 1
+  registers[4] = toBcd(date.day);
+  registers[5] = toBcd(date.month);
+  registers[6] = toBcd(date.year - 2000);
+}
+
+static void writeRegister(uint8_t address, uint8_t value)
+{
+  switch (address)
+  {
+  case 0:
+    chainReset = hostNanos();
+    secondsWritten = true;
+    timeWritten = true;
+    registers[0] = value;
+    break;
+
+  case 1:
+  case 2:
+  case 3:
+  case 4:
+  case 5:
+  case 6:
+    timeWritten = true;
+    registers[address] = value;
+    break;
+
+  case control_register:
+    registers[address] = value & ~_BV(CONV); // the conversion is done right away
+    if (squareWaveOn != !(value & _BV(INTCN)))
+    {
+      squareWaveOn = !squareWaveOn;
+      restartSquareWave();
+    }
+    break;
+
+  case status_register:
+    registers[address] = (registers[address] & value & _BV(OSF)) | (value & 0x0B); // OSF can only be cleared
+    break;
+
+  case aging_offset_register:
+    registers[address] = value;
+    agingOffset = (int8_t)value;
+    updateFrequency();
+    break;
+
+  case temperature_register:
+  case temperature_register + 1:
+    break;
+
+  default: // alarms
+    registers[address] = value;
+    break;
+  }
+}
+
+// takes the written time registers, counted from the seconds write
+static void applyTime()
+{
+  uint32_t seconds = daysFromDate(2000 + fromBcd(registers[6]), fromBcd(registers[5] & 0x1F),
+                                  fromBcd(registers[4])) * seconds_per_day +
+                     fromBcd(registers[2] & 0x3F) * 3600UL + fromBcd(registers[1]) * 60UL + fromBcd(registers[0]);
+
+  if (secondsWritten)
+  {
+    setSeconds = seconds;
+    setTime = chainReset;
+  }
+  else
+    setSeconds = seconds - rtcNanos() / host_nanoseconds_per_second;
+  restartSquareWave();
+}
+
+void hostRtcI2cStart(bool read)
+{
+  copyTime();
+  pointerNext = !read;
+}
+
+bool hostRtcI2cWrite(uint8_t data)
+{
+  if (pointerNext)
+    pointer = data % register_count;
+  else
+  {
+    writeRegister(pointer, data);
+    pointer = (pointer + 1) % register_count;
+  }
+  pointerNext = false;
+  return true;
+}
+
+uint8_t hostRtcI2cRead()
+{
+  uint8_t data = registers[pointer];
+
+  pointer = (pointer + 1) % register_count;
+  if (pointer == 0)
+    copyTime();
+  return data;
+}
+
+void hostRtcI2cStop()
+{
+  transactions++;
+  if (timeWritten)
+    applyTime();
+  timeWritten = false;
+  secondsWritten = false;
+}
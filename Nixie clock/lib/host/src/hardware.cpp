@@ -0,0 +1,732 @@
+#include <Arduino.h>
+#include <avr/eeprom.h>
+#include <avr/sleep.h>
+#include <map>
+#include <utility>
+#include "host.h"
+#include "host_internal.h"
+
+/*
+Virtual time, pins, interrupts, sleep and EEPROM of the native build.
+
+Timer0 and Timer2 count awake time only. Their events are computed from the registers when the next event is
+looked for, so changing prescaler or compare value takes effect at the next event like on the MCU. Timer2 is
+only stepped through while one of its interrupts is enabled, otherwise its flags are caught up at the next event.
+
+Activity is counted for everything outside interrupts that can be seen outside the MCU (port, EEPROM, serial and
+RTC access), so a runner can tell a loop() that only polled from one that did something.
+*/
+
+const uint64_t timer0_period = 1024000;    // 64 * 256 clocks at 16MHz
+const uint64_t port_write_time = 125;      // two clocks
+const uint64_t interrupt_time = 1250;      // entering and leaving an interrupt handler with a few registers saved
+const uint64_t millis_time = 2000;         // millis() and micros() disable interrupts and copy a few bytes
+const uint64_t digital_write_time = 4000;  // digitalWrite() and digitalRead() look up the pin in tables
+const uint64_t eeprom_write_time = 3400000;
+const int max_listeners = 4;
+
+HostPortRegister PORTB(0, HostPortRegister::PORT), DDRB(0, HostPortRegister::DDR), PINB(0, HostPortRegister::PIN);
+HostPortRegister PORTC(1, HostPortRegister::PORT), DDRC(1, HostPortRegister::DDR), PINC(1, HostPortRegister::PIN);
+HostPortRegister PORTD(2, HostPortRegister::PORT), DDRD(2, HostPortRegister::DDR), PIND(2, HostPortRegister::PIN);
+
+volatile uint8_t SREG, MCUSR, SMCR, PRR;
+volatile uint8_t PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2, EICRA, EIMSK, EIFR;
+volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, OCR0B, TIMSK0, TIFR0;
+volatile uint8_t TCCR1A, TCCR1B, TCCR1C, TIMSK1, TIFR1;
+volatile uint16_t TCNT1, OCR1A, OCR1B;
+volatile uint8_t TCCR2A, TCCR2B, TCNT2, OCR2A, OCR2B, TIMSK2, TIFR2;
+volatile uint8_t ADCSRA;
+volatile uint8_t TWBR, TWSR, TWAR, TWDR;
+
+// handlers that the clock doesn't define stay null
+extern "C"
+{
+  void PCINT0_vect(void) __attribute__((weak));
+  void PCINT1_vect(void) __attribute__((weak));
+  void PCINT2_vect(void) __attribute__((weak));
+  void TIMER2_COMPA_vect(void) __attribute__((weak));
+  void TIMER2_OVF_vect(void) __attribute__((weak));
+  void TIMER1_OVF_vect(void) __attribute__((weak));
+  void TIMER0_COMPA_vect(void) __attribute__((weak));
+  void TWI_vect(void) __attribute__((weak));
+}
+
+static void (*const vectors[HOST_VECTOR_COUNT])(void) = {
+    PCINT0_vect, PCINT1_vect, PCINT2_vect, TIMER2_COMPA_vect, TIMER2_OVF_vect, TIMER1_OVF_vect, TIMER0_COMPA_vect,
+    TWI_vect};
+
+// state of a port, the level is what the pins show outside
+struct Port
+{
+  uint8_t port;
+  uint8_t ddr;
+  uint8_t driven;   // input pins driven from outside
+  uint8_t external; // levels of the driven pins
+  uint8_t level;
+};
+
+static Port ports[3];
+static const uint8_t first_pin[3] = {8, 14, 0};  // Arduino number of bit 0 of ports B, C and D
+static const uint8_t usable_bits[3] = {6, 6, 8}; // PB6/PB7 hold the crystal and PC6 is reset
+
+static void (*pinListeners[max_listeners])(uint8_t pin, bool level);
+static int pinListenerCount = 0;
+
+static uint64_t now = 0;
+static uint64_t awake = 0;
+static uint64_t endTime = UINT64_MAX;
+static std::multimap<uint64_t, std::pair<void (*)(long), long>> actions;
+
+static uint16_t pendingInterrupts = 0;
+static bool inInterrupt = false;
+static bool externalEvent = false; // an action has run or a pin change or TWI interrupt has been served
+static bool timerEvent = false;    // a timer interrupt has been served
+static unsigned long activity = 0;
+static unsigned long sleeps = 0;
+static bool woken = false;
+static bool sleepEnabled = false;
+static bool sleeping = false;
+static bool timersStopped = false;
+static uint8_t sleepMode = SLEEP_MODE_IDLE;
+
+static uint64_t timer0Next = timer0_period; // awake time of the next compare match
+static bool timer2Running = false;
+static uint64_t timer2Bottom = 0; // awake time of the last overflow
+static bool timer2Matched = false;
+
+uint8_t hostEeprom[host_eeprom_size];
+static uint64_t eepromReadyTime = 0;
+
+// EEPROM of a new MCU is erased
+static struct Reset
+{
+  Reset() { memset(hostEeprom, 0xFF, sizeof(hostEeprom)); }
+} reset;
+
+static uint8_t portLevel(const Port &port)
+{
+  uint8_t inputs = ~port.ddr;
+  uint8_t outside = (port.driven & port.external) | (~port.driven & port.port); // pullup or nothing
+
+  return (port.ddr & port.port) | (inputs & outside);
+}
+
+static volatile uint8_t &pinChangeMask(uint8_t index)
+{
+  return index == 0 ? PCMSK0 : index == 1 ? PCMSK1 : PCMSK2;
+}
+
+// recomputes pin levels of a port, notifies the listeners and sets the pin change flag
+static void updatePort(uint8_t index)
+{
+  Port &port = ports[index];
+  uint8_t level = portLevel(port);
+  uint8_t changed = level ^ port.level;
+
+  if (!changed)
+    return;
+
+  port.level = level;
+  for (uint8_t bit = 0; bit < usable_bits[index]; bit++)
+  {
+    if (changed & _BV(bit))
+    {
+      for (int i = 0; i < pinListenerCount; i++)
+        pinListeners[i](first_pin[index] + bit, level & _BV(bit));
+    }
+  }
+  if (changed & pinChangeMask(index))
+  {
+    PCIFR |= _BV(index);
+    hostRequestInterrupt((HostVector)(HOST_VECTOR_PCINT0 + index));
+  }
+}
+
+// returns port index and bit of an Arduino pin
+static bool findPin(uint8_t pin, uint8_t &index, uint8_t &bit)
+{
+  if (pin < 8)
+  {
+    index = 2;
+    bit = pin;
+  }
+  else if (pin < 14)
+  {
+    index = 0;
+    bit = pin - 8;
+  }
+  else if (pin < host_pin_count)
+  {
+    index = 1;
+    bit = pin - 14;
+  }
+  else
+    return false;
+  return true;
+}
+
+static bool interruptEnabled(uint8_t vector)
+{
+  switch (vector)
+  {
+  case HOST_VECTOR_PCINT0:
+  case HOST_VECTOR_PCINT1:
+  case HOST_VECTOR_PCINT2:
+    return PCICR & _BV(vector - HOST_VECTOR_PCINT0);
+  case HOST_VECTOR_TIMER2_COMPA:
+    return TIMSK2 & _BV(OCIE2A);
+  case HOST_VECTOR_TIMER2_OVF:
+    return TIMSK2 & _BV(TOIE2);
+  case HOST_VECTOR_TIMER1_OVF:
+    return TIMSK1 & _BV(TOIE1);
+  case HOST_VECTOR_TIMER0_COMPA:
+    return TIMSK0 & _BV(OCIE0A);
+  case HOST_VECTOR_TWI:
+    return (hostTwiControl() & _BV(TWIE)) && (hostTwiControl() & _BV(TWINT));
+  }
+  return false;
+}
+
+// returns true if an enabled interrupt is waiting
+static bool interruptWaiting()
+{
+  for (int i = 0; i < HOST_VECTOR_COUNT; i++)
+  {
+    if ((pendingInterrupts & _BV(i)) && interruptEnabled(i))
+      return true;
+  }
+  return false;
+}
+
+static void moveTo(uint64_t time)
+{
+  if (time <= now)
+    return;
+  if (!timersStopped)
+    awake += time - now;
+  now = time;
+}
+
+// returns virtual time of an event given in awake time, due events return now
+static uint64_t awakeEvent(uint64_t time)
+{
+  return time <= awake ? now : now + (time - awake);
+}
+
+static uint64_t timer2Prescaler()
+{
+  static const uint16_t prescalers[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+
+  return prescalers[TCCR2B & 0x07];
+}
+
+static uint64_t timer2Period()
+{
+  return 16000 * timer2Prescaler(); // 256 counts of 62.5ns times prescaler
+}
+
+static uint64_t timer2Match()
+{
+  return timer2Bottom + (OCR2A + 1) * timer2Prescaler() * 125 / 2;
+}
+
+// returns virtual time of the next event, Timer0 compare match is left out if asked for
+static uint64_t nextEvent(bool withTimer0 = true)
+{
+  uint64_t next = actions.empty() ? UINT64_MAX : actions.begin()->first;
+
+  if (timersStopped)
+    return next;
+
+  if (withTimer0)
+    next = min(next, awakeEvent(timer0Next));
+
+  if (timer2Prescaler() == 0)
+    timer2Running = false;
+  else
+  {
+    if (!timer2Running)
+    {
+      timer2Running = true;
+      timer2Bottom = awake;
+      timer2Matched = false;
+    }
+    if (!timer2Matched && (TIMSK2 & _BV(OCIE2A)))
+      next = min(next, awakeEvent(timer2Match()));
+    if (TIMSK2 & _BV(TOIE2))
+      next = min(next, awakeEvent(timer2Bottom + timer2Period()));
+  }
+  return next;
+}
+
+// runs due actions and sets flags of due timer interrupts
+static void fireEvents()
+{
+  while (!actions.empty() && actions.begin()->first <= now)
+  {
+    std::pair<void (*)(long), long> action = actions.begin()->second;
+
+    actions.erase(actions.begin());
+    action.first(action.second);
+    externalEvent = true;
+  }
+
+  if (timersStopped)
+    return;
+
+  if (awake >= timer0Next)
+  {
+    timer0Next += timer0_period;
+    hostRequestInterrupt(HOST_VECTOR_TIMER0_COMPA);
+  }
+  if (timer2Running)
+  {
+    uint64_t period = timer2Period();
+
+    if (awake >= timer2Bottom + period)
+    {
+      // more than one period passes while the interrupts are off, the flags stay set like on the MCU
+      if (!timer2Matched || awake >= timer2Bottom + 2 * period)
+        hostRequestInterrupt(HOST_VECTOR_TIMER2_COMPA);
+      timer2Bottom += (awake - timer2Bottom) / period * period;
+      timer2Matched = false;
+      hostRequestInterrupt(HOST_VECTOR_TIMER2_OVF);
+    }
+    if (!timer2Matched && awake >= timer2Match())
+    {
+      timer2Matched = true;
+      hostRequestInterrupt(HOST_VECTOR_TIMER2_COMPA);
+    }
+  }
+}
+
+static void runUntil(uint64_t time);
+
+// runs pending interrupts by priority, unless interrupts are off or a handler is running already
+static void serviceInterrupts()
+{
+  while ((SREG & _BV(SREG_I)) && !inInterrupt)
+  {
+    int vector = -1;
+
+    for (int i = 0; i < HOST_VECTOR_COUNT; i++)
+    {
+      if ((pendingInterrupts & _BV(i)) && interruptEnabled(i))
+      {
+        vector = i;
+        break;
+      }
+    }
+    if (vector < 0)
+      return;
+
+    if (vector != HOST_VECTOR_TWI) // TWINT stays set until the handler clears it
+      pendingInterrupts &= ~_BV(vector);
+    if (vector <= HOST_VECTOR_PCINT2)
+      PCIFR &= ~_BV(vector - HOST_VECTOR_PCINT0);
+    woken = true;
+    if (!vectors[vector])
+      continue;
+    if (vector <= HOST_VECTOR_PCINT2 || vector == HOST_VECTOR_TWI)
+      externalEvent = true;
+    else
+      timerEvent = true;
+
+    inInterrupt = true;
+    SREG &= ~_BV(SREG_I);
+    runUntil(now + interrupt_time);
+    vectors[vector]();
+    SREG |= _BV(SREG_I);
+    inInterrupt = false;
+  }
+}
+
+static void runUntil(uint64_t time)
+{
+  for (uint64_t next = nextEvent(); next <= time; next = nextEvent())
+  {
+    moveTo(next);
+    fireEvents();
+    serviceInterrupts();
+  }
+  moveTo(time);
+  serviceInterrupts();
+}
+
+void hostNoteActivity()
+{
+  if (!inInterrupt)
+    activity++;
+}
+
+void hostRequestInterrupt(HostVector vector)
+{
+  pendingInterrupts |= _BV(vector);
+}
+
+void hostSetPortBit(uint8_t pin, bool level)
+{
+  uint8_t index, bit;
+
+  if (!findPin(pin, index, bit))
+    return;
+  if (level)
+    ports[index].port |= _BV(bit);
+  else
+    ports[index].port &= ~_BV(bit);
+  updatePort(index);
+  hostNoteActivity();
+}
+
+HostPortRegister::operator uint8_t() const
+{
+  const Port &state = ports[port];
+
+  return kind == PORT ? state.port : kind == DDR ? state.ddr : state.level;
+}
+
+HostPortRegister &HostPortRegister::operator=(uint8_t value)
+{
+  Port &state = ports[port];
+
+  if (kind == PORT)
+    state.port = value;
+  else if (kind == DDR)
+    state.ddr = value;
+  else
+    state.port ^= value; // writing PINx toggles PORTx bits
+  updatePort(port);
+  hostNoteActivity();
+  runUntil(now + port_write_time);
+  return *this;
+}
+
+uint64_t hostNanos()
+{
+  return now;
+}
+
+uint64_t hostAwakeNanos()
+{
+  return awake;
+}
+
+void hostAdvance(uint64_t nanoseconds)
+{
+  runUntil(now + nanoseconds);
+}
+
+/*
+Timer0 compare matches are most of the events while the MCU is awake, so the ones before any other event are run
+here without the general event loop. It returns as soon as a handler may have changed what comes next.
+*/
+static void runTimer0(uint64_t limit)
+{
+  uint64_t other = min(limit, nextEvent(false));
+  uint8_t timer2Interrupts = TIMSK2;
+  uint16_t pending = pendingInterrupts;
+  unsigned long scheduled = actions.size();
+
+  if (timersStopped || inInterrupt || externalEvent || interruptWaiting() || !TIMER0_COMPA_vect)
+    return;
+
+  while ((SREG & _BV(SREG_I)) && (TIMSK0 & _BV(OCIE0A)))
+  {
+    uint64_t tick = awakeEvent(timer0Next);
+
+    if (tick + interrupt_time >= other)
+      return;
+
+    moveTo(tick + interrupt_time);
+    timer0Next += timer0_period;
+    inInterrupt = true;
+    SREG &= ~_BV(SREG_I);
+    TIMER0_COMPA_vect();
+    SREG |= _BV(SREG_I);
+    inInterrupt = false;
+    timerEvent = true;
+
+    if (pendingInterrupts != pending || TIMSK2 != timer2Interrupts || actions.size() != scheduled ||
+        (!actions.empty() && actions.begin()->first < other))
+      return;
+  }
+}
+
+void hostRunToNextEvent(bool timers, uint64_t limit)
+{
+  externalEvent = false;
+  timerEvent = false;
+  while (!externalEvent && !(timers && timerEvent))
+  {
+    if (!timers)
+      runTimer0(limit);
+
+    uint64_t next = nextEvent();
+
+    if (next >= limit)
+    {
+      runUntil(limit);
+      return;
+    }
+    moveTo(next);
+    fireEvents();
+    serviceInterrupts();
+  }
+}
+
+unsigned long hostActivity()
+{
+  return activity;
+}
+
+void hostAt(uint64_t time, void (*action)(long), long argument)
+{
+  actions.insert(std::make_pair(max(time, now), std::make_pair(action, argument)));
+}
+
+void hostSetEndTime(uint64_t time)
+{
+  endTime = time;
+}
+
+bool hostFinished()
+{
+  return now >= endTime;
+}
+
+bool hostSleeping()
+{
+  return sleeping;
+}
+
+unsigned long hostSleeps()
+{
+  return sleeps;
+}
+
+void hostDrivePin(uint8_t pin, bool level)
+{
+  uint8_t index, bit;
+
+  if (!findPin(pin, index, bit))
+    return;
+  ports[index].driven |= _BV(bit);
+  if (level)
+    ports[index].external |= _BV(bit);
+  else
+    ports[index].external &= ~_BV(bit);
+  updatePort(index);
+}
+
+void hostReleasePin(uint8_t pin)
+{
+  uint8_t index, bit;
+
+  if (!findPin(pin, index, bit))
+    return;
+  ports[index].driven &= ~_BV(bit);
+  updatePort(index);
+}
+
+bool hostPinLevel(uint8_t pin)
+{
+  uint8_t index, bit;
+
+  return findPin(pin, index, bit) && (ports[index].level & _BV(bit));
+}
+
+bool hostPinIsOutput(uint8_t pin)
+{
+  uint8_t index, bit;
+
+  return findPin(pin, index, bit) && (ports[index].ddr & _BV(bit));
+}
+
+void hostOnPinChange(void (*listener)(uint8_t pin, bool level))
+{
+  if (pinListenerCount < max_listeners)
+    pinListeners[pinListenerCount++] = listener;
+}
+
+void cli()
+{
+  SREG &= ~_BV(SREG_I);
+}
+
+// like on the MCU, pending interrupts run after the next instruction, so "sei(); sleep_cpu();" can't miss a wake up
+void sei()
+{
+  SREG |= _BV(SREG_I);
+}
+
+void interrupts()
+{
+  sei();
+}
+
+void noInterrupts()
+{
+  cli();
+}
+
+unsigned long millis()
+{
+  runUntil(now + millis_time);
+  return awake / 1000000;
+}
+
+unsigned long micros()
+{
+  runUntil(now + millis_time);
+  return awake / 1000;
+}
+
+void delay(unsigned long ms)
+{
+  runUntil(now + ms * 1000000ULL);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  runUntil(now + us * 1000ULL);
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  uint8_t index, bit;
+
+  if (!findPin(pin, index, bit))
+    return;
+  if (mode == OUTPUT)
+    ports[index].ddr |= _BV(bit);
+  else
+  {
+    ports[index].ddr &= ~_BV(bit);
+    if (mode == INPUT_PULLUP)
+      ports[index].port |= _BV(bit);
+    else
+      ports[index].port &= ~_BV(bit);
+  }
+  updatePort(index);
+  hostNoteActivity();
+  runUntil(now + digital_write_time);
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  hostSetPortBit(pin, value != LOW);
+  runUntil(now + digital_write_time);
+}
+
+int digitalRead(uint8_t pin)
+{
+  runUntil(now + digital_write_time);
+  return hostPinLevel(pin) ? HIGH : LOW;
+}
+
+void set_sleep_mode(uint8_t mode)
+{
+  sleepMode = mode;
+}
+
+void sleep_enable()
+{
+  sleepEnabled = true;
+}
+
+void sleep_disable()
+{
+  sleepEnabled = false;
+}
+
+void sleep_bod_disable()
+{
+}
+
+void sleep_cpu()
+{
+  if (!sleepEnabled)
+    return;
+
+  sleeping = true;
+  sleeps++;
+  woken = false;
+  timersStopped = sleepMode == SLEEP_MODE_PWR_DOWN;
+  serviceInterrupts(); // pending interrupts wake up right away
+
+  while (!woken)
+  {
+    uint64_t next = nextEvent();
+
+    if (next >= endTime)
+    {
+      moveTo(endTime);
+      break;
+    }
+    moveTo(next);
+    fireEvents();
+    serviceInterrupts();
+  }
+
+  timersStopped = false;
+  sleeping = false;
+}
+
+// EEPROM functions of avr-libc wait until the previous write is done
+static void eepromWait()
+{
+  runUntil(eepromReadyTime);
+}
+
+static int eepromIndex(const void *address)
+{
+  return (uintptr_t)address % host_eeprom_size;
+}
+
+static void eepromWrite(int index, uint8_t value)
+{
+  eepromWait();
+  hostEeprom[index] = value;
+  eepromReadyTime = now + eeprom_write_time;
+  hostNoteActivity();
+}
+
+uint8_t eeprom_read_byte(const uint8_t *address)
+{
+  eepromWait();
+  return hostEeprom[eepromIndex(address)];
+}
+
+void eeprom_write_byte(uint8_t *address, uint8_t value)
+{
+  eepromWrite(eepromIndex(address), value);
+}
+
+void eeprom_update_byte(uint8_t *address, uint8_t value)
+{
+  if (eeprom_read_byte(address) != value)
+    eeprom_write_byte(address, value);
+}
+
+void eeprom_read_block(void *destination, const void *source, size_t size)
+{
+  for (size_t i = 0; i < size; i++)
+    ((uint8_t *)destination)[i] = eeprom_read_byte((const uint8_t *)source + i);
+}
+
+void eeprom_write_block(const void *source, void *destination, size_t size)
+{
+  for (size_t i = 0; i < size; i++)
+    eeprom_write_byte((uint8_t *)destination + i, ((const uint8_t *)source)[i]);
+}
+
+void eeprom_update_block(const void *source, void *destination, size_t size)
+{
+  for (size_t i = 0; i < size; i++)
+    eeprom_update_byte((uint8_t *)destination + i, ((const uint8_t *)source)[i]);
+}
+
+int eeprom_is_ready()
+{
+  return now >= eepromReadyTime;
+}
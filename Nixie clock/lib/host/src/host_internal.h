@@ -0,0 +1,53 @@
+#ifndef HOST_INTERNAL_H
+#define HOST_INTERNAL_H
+
+#include <stdint.h>
+
+// interrupt vectors of the model, in priority order (lower number is served first)
+enum HostVector
+{
+  HOST_VECTOR_PCINT0,
+  HOST_VECTOR_PCINT1,
+  HOST_VECTOR_PCINT2,
+  HOST_VECTOR_TIMER2_COMPA,
+  HOST_VECTOR_TIMER2_OVF,
+  HOST_VECTOR_TIMER1_OVF,
+  HOST_VECTOR_TIMER0_COMPA,
+  HOST_VECTOR_TWI,
+  HOST_VECTOR_COUNT
+};
+
+// counts something that can be seen outside the MCU (ignored in interrupts, see hostActivity())
+void hostNoteActivity();
+
+// sets the flag of an interrupt, it runs as soon as it is enabled and global interrupts are on
+void hostRequestInterrupt(HostVector vector);
+
+/**
+ * Changes the output register bit of a pin without moving virtual time (used by peripherals)
+ * @param pin Arduino pin number
+ * @param level new level
+ */
+void hostSetPortBit(uint8_t pin, bool level);
+
+// returns TWCR without taking time
+uint8_t hostTwiControl();
+
+// I2C slave side of the simulated DS3231, called by the TWI model when the bus gets to it
+
+/**
+ * Start or repeated start followed by the DS3231 address
+ * @param read true if the master reads
+ */
+void hostRtcI2cStart(bool read);
+
+// byte written by the master, returns false if it isn't acknowledged
+bool hostRtcI2cWrite(uint8_t data);
+
+// returns next byte for the master
+uint8_t hostRtcI2cRead();
+
+// stop condition after a transfer with the DS3231
+void hostRtcI2cStop();
+
+#endif
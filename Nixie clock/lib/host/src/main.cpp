@@ -0,0 +1,218 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <time.h>
+#include "bridge.h"
+#include "debounce_bench.h"
+#include "display_model.h"
+#include "ds3231.h"
+#include "host.h"
+#include "pins.h"
+#include "script.h"
+#include "vcd.h"
+
+/*
+Simulator of the native build: runs the clock in virtual time, follows a script of motion, button presses and
+serial input (script.h) and prints the display whenever it changes. Pin changes can be recorded to a VCD file
+(vcd.h) and checked with tools/vcd_check.py. With --debounce-bench it runs the debounce benchmark
+(debounce_bench.h) instead, with --bridge it is a serial port for tools/nixie.py on stdin and stdout (bridge.h).
+
+  program [--script file] [--seconds n] [--start "YYYY-MM-DD HH:MM:SS"] [--exact] [--quiet] [--serial]
+          [--vcd file]
+  program --debounce-bench [--runs n] [--seed n]
+  program --bridge [--start "YYYY-MM-DD HH:MM:SS"] [--drift ppm] [--aging-step ppm] [--jitter us] [--seed n]
+
+Virtual time jumps over loop() calls that would only poll: after a loop() without activity (see hostActivity())
+the next one runs at the next event, which is a script action, a square wave edge or another pin change, or
+after poll_time at the latest. For settle_time after a loop() that did something or an input from the script,
+loop() runs after every interrupt, which is as often as millis() changes on the MCU, so debouncing and cathode
+routine steps keep their timing. A loop() that has slept is followed by the next one right away, like on the MCU, so time spent awake
+stays right. With --exact loop() is called back to back like on the MCU (much slower).
+*/
+
+const uint64_t poll_time = 250000000ULL;  // longest virtual time without a loop() call
+const uint64_t settle_time = 100000000ULL; // loop() follows every interrupt for this long after activity
+const uint32_t unix_time_2000 = 946684800UL;
+const char default_start[] = "2021-01-01 00:00:00";
+
+static bool quiet = false;
+static char shown[32] = "";
+static uint64_t litSince = 0;
+static uint64_t litTime = 0;
+static bool lit = false;
+
+static void printSerial(uint8_t data)
+{
+  putchar(data);
+}
+
+// prints the display if it has changed and keeps track of the time it was lit
+static void showDisplay()
+{
+  char text[sizeof(shown)];
+
+  if (displayModelLit() != lit)
+  {
+    lit = !lit;
+    if (lit)
+      litSince = hostNanos();
+    else
+      litTime += hostNanos() - litSince;
+  }
+
+  // digits only matter while they can be seen
+  displayModelText(text, sizeof(text));
+  if (strcmp(text, shown) == 0 || (!lit && strstr(shown, " dark ")))
+    return;
+
+  strcpy(shown, text);
+  if (!quiet)
+  {
+    char time[32];
+
+    scriptTimeText(time, sizeof(time), hostNanos());
+    printf("%s  %s\n", time, text);
+  }
+}
+
+// returns seconds since 2000-01-01 00:00:00 of "YYYY-MM-DD HH:MM:SS", 0 if it isn't valid
+static uint32_t parseStart(const char *text)
+{
+  struct tm date = {};
+
+  if (sscanf(text, "%d-%d-%d %d:%d:%d", &date.tm_year, &date.tm_mon, &date.tm_mday, &date.tm_hour, &date.tm_min,
+             &date.tm_sec) != 6 ||
+      date.tm_year < 2000 || date.tm_year > 2099)
+    return 0;
+  date.tm_year -= 1900;
+  date.tm_mon -= 1;
+  return timegm(&date) - unix_time_2000;
+}
+
+static int usage()
+{
+  fprintf(stderr, "usage: program [--script file] [--seconds n] [--start \"YYYY-MM-DD HH:MM:SS\"] [--exact] "
+                  "[--quiet] [--serial] [--vcd file]\n"
+                  "       program --debounce-bench [--runs n] [--seed n]\n"
+                  "       program --bridge [--start \"YYYY-MM-DD HH:MM:SS\"] [--drift ppm] [--aging-step ppm] "
+                  "[--jitter us] [--seed n]\n");
+  return 2;
+}
+
+int main(int argc, char *argv[])
+{
+  const char *script = nullptr;
+  const char *start = default_start;
+  const char *vcd = nullptr;
+  double seconds = 0;
+  bool exact = false;
+  bool debounce = false;
+  bool serialBridge = false;
+  double drift = 0;
+  double agingStep = ds3231_aging_step_ppm;
+  double jitter = 0;
+  int runs = 1000;
+  unsigned seed = 1;
+
+  for (int i = 1; i < argc; i++)
+  {
+    bool hasValue = i + 1 < argc;
+
+    if (strcmp(argv[i], "--script") == 0 && hasValue)
+      script = argv[++i];
+    else if (strcmp(argv[i], "--seconds") == 0 && hasValue)
+      seconds = atof(argv[++i]);
+    else if (strcmp(argv[i], "--start") == 0 && hasValue)
+      start = argv[++i];
+    else if (strcmp(argv[i], "--exact") == 0)
+      exact = true;
+    else if (strcmp(argv[i], "--quiet") == 0)
+      quiet = true;
+    else if (strcmp(argv[i], "--vcd") == 0 && hasValue)
+      vcd = argv[++i];
+    else if (strcmp(argv[i], "--debounce-bench") == 0)
+      debounce = true;
+    else if (strcmp(argv[i], "--bridge") == 0)
+      serialBridge = true;
+    else if (strcmp(argv[i], "--drift") == 0 && hasValue)
+      drift = atof(argv[++i]);
+    else if (strcmp(argv[i], "--aging-step") == 0 && hasValue)
+      agingStep = atof(argv[++i]);
+    else if (strcmp(argv[i], "--jitter") == 0 && hasValue)
+      jitter = atof(argv[++i]);
+    else if (strcmp(argv[i], "--runs") == 0 && hasValue)
+      runs = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+      seed = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--serial") == 0)
+      hostOnSerialOutput(printSerial);
+    else
+      return usage();
+  }
+
+  if (debounce)
+    return runs > 0 ? debounceBench(runs, seed) : usage();
+
+  uint32_t startSeconds = parseStart(start);
+  uint64_t end = seconds > 0 ? seconds * host_nanoseconds_per_second : 0;
+
+  if (startSeconds == 0)
+    return usage();
+  if (serialBridge)
+    return jitter >= 0 ? bridge(startSeconds, drift, agingStep, jitter, seed) : usage();
+  if (script && !scriptLoad(script, end))
+    return 1;
+  if (end == 0)
+    end = (script ? 86400ULL : 60ULL) * host_nanoseconds_per_second;
+
+  clock_t wallStart = clock();
+  unsigned long loops = 0;
+  uint64_t settleEnd = 0;
+
+  hostRtcSet(startSeconds);
+  hostDrivePin(Board::Sensor::number, LOW); // PIR output, no motion
+  hostSetEndTime(end);
+  displayModelBegin();
+  if (vcd && !vcdBegin(vcd))
+  {
+    fprintf(stderr, "%s: can't be written\n", vcd);
+    return 1;
+  }
+
+  sei(); // done by the Arduino core before setup()
+  setup();
+  while (!hostFinished())
+  {
+    unsigned long activity = hostActivity();
+    unsigned long sleeps = hostSleeps();
+
+    loop();
+    loops++;
+    showDisplay();
+    if (exact || hostFinished() || hostSleeps() != sleeps)
+      continue;
+
+    unsigned long inputs = scriptInputs();
+
+    if (hostActivity() != activity)
+      settleEnd = hostNanos() + settle_time;
+    hostRunToNextEvent(hostNanos() < settleEnd, min(hostNanos() + poll_time, end));
+    if (scriptInputs() != inputs)
+      settleEnd = hostNanos() + settle_time;
+  }
+  showDisplay();
+  vcdEnd();
+
+  char time[32], litText[32], awakeText[32];
+
+  scriptTimeText(time, sizeof(time), hostNanos());
+  scriptTimeText(litText, sizeof(litText), litTime + (lit ? hostNanos() - litSince : 0));
+  scriptTimeText(awakeText, sizeof(awakeText), hostAwakeNanos());
+  fflush(stdout);
+  fprintf(stderr, "%s run in %.3f s: %lu loop() calls, lit %s, awake %s, %lu frames latched, %lu RTC transactions",
+          time, (double)(clock() - wallStart) / CLOCKS_PER_SEC, loops, litText, awakeText, displayModelLatches(),
+          hostRtcTransactions());
+  if (script)
+    fprintf(stderr, ", %d expectations passed, %d failed", scriptPassed(), scriptFailed());
+  fprintf(stderr, "\n");
+  return scriptFailed() ? 1 : 0;
+}
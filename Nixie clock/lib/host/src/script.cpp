@@ -0,0 +1,285 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <util/crc16.h>
+#include <string>
+#include <vector>
+#include "display_model.h"
+#include "host.h"
+#include "pins.h"
+#include "protocol.h"
+#include "script.h"
+
+const double default_press_time = 0.2;
+
+enum Command
+{
+  MOTION,
+  PRESS,
+  SERIAL_TEXT,
+  FRAME,
+  DRIFT,
+  I2C,
+  EXPECT,
+  END
+};
+
+struct Action
+{
+  Command command;
+  double value;     // seconds, button, ppm or I2C fault
+  double duration;  // seconds the pin is held
+  std::string text; // serial text, frame bytes or expected display
+  std::string time; // as written in the script
+};
+
+static std::vector<Action> actions;
+static unsigned long inputs = 0;
+static int passed = 0;
+static int failed = 0;
+
+static const uint8_t button_pins[number_of_buttons] = {Board::Button0::number, Board::Button1::number,
+                                                       Board::Button2::number};
+
+static uint64_t seconds(double value)
+{
+  return value * host_nanoseconds_per_second + 0.5;
+}
+
+// parses [<days>d] HH:MM[:SS[.mmm]], the rest of the line is returned in rest
+static bool parseTime(const char *line, uint64_t &time, const char *&rest)
+{
+  unsigned days = 0, hours, minutes;
+  double secondsOfMinute = 0;
+  int length = 0;
+
+  if (sscanf(line, " %ud %n", &days, &length) == 1 && length > 0)
+    line += length;
+  else
+    days = 0;
+
+  length = 0;
+  if (sscanf(line, " %u:%u%n", &hours, &minutes, &length) != 2)
+    return false;
+  line += length;
+  if (*line == ':')
+  {
+    length = 0;
+    if (sscanf(line, ":%lf%n", &secondsOfMinute, &length) != 1)
+      return false;
+    line += length;
+  }
+
+  time = (uint64_t)days * 86400 * host_nanoseconds_per_second + (hours * 3600ULL + minutes * 60) * host_nanoseconds_per_second +
+         seconds(secondsOfMinute);
+  rest = line;
+  return true;
+}
+
+static void release(long pin)
+{
+  inputs++;
+  if (pin == Board::Sensor::number)
+    hostDrivePin(pin, LOW); // PIR output is push-pull
+  else
+    hostReleasePin(pin); // buttons have pullups
+}
+
+static void run(long index)
+{
+  const Action &action = actions[index];
+  char display[32];
+  uint8_t pin;
+
+  if (action.command == MOTION || action.command == PRESS || action.command == SERIAL_TEXT || action.command == FRAME)
+    inputs++;
+
+  switch (action.command)
+  {
+  case MOTION:
+    hostDrivePin(Board::Sensor::number, HIGH);
+    hostAt(hostNanos() + seconds(action.value), release, Board::Sensor::number);
+    break;
+  case PRESS:
+    pin = button_pins[(int)action.value];
+    hostDrivePin(pin, LOW);
+    hostAt(hostNanos() + seconds(action.duration), release, pin);
+    break;
+  case SERIAL_TEXT:
+    hostSerialInput((const uint8_t *)(action.text + "\n").c_str(), action.text.size() + 1);
+    break;
+  case FRAME:
+    hostSerialInput((const uint8_t *)action.text.data(), action.text.size());
+    break;
+  case DRIFT:
+    hostRtcSetDrift(action.value);
+    break;
+  case I2C:
+    hostI2cFault((HostI2cFault)action.value);
+    break;
+  case EXPECT:
+    displayModelText(display, sizeof(display));
+    if (strncmp(display + strspn(display, " "), action.text.c_str(), action.text.size()) == 0)
+      passed++;
+    else
+    {
+      failed++;
+      printf("%s expected \"%s\", display shows \"%s\"\n", action.time.c_str(), action.text.c_str(), display);
+    }
+    break;
+  case END:
+    break;
+  }
+}
+
+// parses the arguments of a command, returns false if they aren't right
+static bool parseAction(const char *name, const char *arguments, Action &action)
+{
+  char extra;
+
+  action.duration = 0;
+  if (strcmp(name, "motion") == 0)
+  {
+    action.command = MOTION;
+    return sscanf(arguments, "%lf %c", &action.value, &extra) == 1 && action.value > 0;
+  }
+  if (strcmp(name, "press") == 0)
+  {
+    int count = sscanf(arguments, "%lf %lf %c", &action.value, &action.duration, &extra);
+
+    action.command = PRESS;
+    if (count == 1)
+      action.duration = default_press_time;
+    return (count == 1 || count == 2) && action.value >= 0 && action.value < number_of_buttons &&
+           action.duration > 0;
+  }
+  if (strcmp(name, "drift") == 0)
+  {
+    action.command = DRIFT;
+    return sscanf(arguments, "%lf %c", &action.value, &extra) == 1;
+  }
+  // command and payload as hex bytes, framed with sync, length and CRC (protocol.h)
+  if (strcmp(name, "frame") == 0)
+  {
+    std::string bytes;
+    unsigned value;
+    int length;
+    uint16_t crc = 0xFFFF;
+
+    action.command = FRAME;
+    while (sscanf(arguments, " %2x%n", &value, &length) == 1)
+    {
+      bytes += (char)value;
+      arguments += length;
+    }
+    if (bytes.empty() || bytes.size() > protocol_max_payload + 1U || arguments[strspn(arguments, " \t")] != 0)
+      return false;
+    bytes.insert(bytes.begin(), (char)(bytes.size() - 1));
+    for (char byte : bytes)
+      crc = _crc_ccitt_update(crc, byte);
+    action.text = (char)protocol_sync + bytes + (char)(crc & 0xFF) + (char)(crc >> 8);
+    return true;
+  }
+  if (strcmp(name, "i2c") == 0)
+  {
+    static const char *const faults[] = {"ok", "no-answer", "stuck"};
+    char fault[16];
+
+    action.command = I2C;
+    if (sscanf(arguments, "%15s %c", fault, &extra) != 1)
+      return false;
+    for (int i = 0; i < 3; i++)
+    {
+      if (strcmp(fault, faults[i]) == 0)
+      {
+        action.value = i;
+        return true;
+      }
+    }
+    return false;
+  }
+  if (strcmp(name, "serial") == 0 || strcmp(name, "expect") == 0)
+  {
+    action.command = name[0] == 's' ? SERIAL_TEXT : EXPECT;
+    action.text = arguments;
+    while (!action.text.empty() && isspace((unsigned char)action.text.back()))
+      action.text.pop_back();
+    return !action.text.empty();
+  }
+  if (strcmp(name, "end") == 0)
+  {
+    action.command = END;
+    return *arguments == 0;
+  }
+  return false;
+}
+
+bool scriptLoad(const char *path, uint64_t &end)
+{
+  FILE *file = fopen(path, "r");
+  char line[256];
+  int lineNumber = 0;
+  bool ok = true;
+
+  if (!file)
+  {
+    fprintf(stderr, "%s: can't be read\n", path);
+    return false;
+  }
+
+  while (fgets(line, sizeof(line), file))
+  {
+    Action action;
+    uint64_t time;
+    const char *rest;
+    char name[16];
+    int length = 0;
+
+    lineNumber++;
+    line[strcspn(line, "#\r\n")] = 0;
+    if (strspn(line, " \t") == strlen(line))
+      continue;
+
+    if (!parseTime(line, time, rest) || sscanf(rest, " %15s %n", name, &length) != 1 ||
+        !parseAction(name, rest + length, action))
+    {
+      fprintf(stderr, "%s:%d: \"%s\" isn't understood\n", path, lineNumber, line);
+      ok = false;
+      continue;
+    }
+
+    char text[32];
+
+    scriptTimeText(text, sizeof(text), time);
+    action.time = text;
+    if (action.command == END)
+      end = time;
+    actions.push_back(action);
+    hostAt(time, run, actions.size() - 1);
+  }
+
+  fclose(file);
+  return ok;
+}
+
+void scriptTimeText(char *text, size_t size, uint64_t time)
+{
+  uint64_t ms = time / 1000000;
+
+  snprintf(text, size, "%ud %02u:%02u:%02u.%03u", (unsigned)(ms / 86400000), (unsigned)(ms / 3600000 % 24),
+           (unsigned)(ms / 60000 % 60), (unsigned)(ms / 1000 % 60), (unsigned)(ms % 1000));
+}
+
+unsigned long scriptInputs()
+{
+  return inputs;
+}
+
+int scriptPassed()
+{
+  return passed;
+}
+
+int scriptFailed()
+{
+  return failed;
+}
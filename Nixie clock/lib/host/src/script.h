@@ -0,0 +1,47 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Scripts of the simulator, one action per line (# starts a comment):
+
+  <time> motion <seconds>          PIR sensor output is high for some seconds
+  <time> press <button> [seconds]  button is held down (0.2 seconds unless given), 0 is menu, 1 up and 2 down
+  <time> serial <text>             text and a newline arrive over serial
+  <time> frame <command> [payload] protocol frame arrives over serial, command and payload as hex bytes
+  <time> drift <ppm>               RTC crystal runs fast (positive) or slow from now on
+  <time> i2c ok|no-answer|stuck    I2C bus to the RTC works, the RTC doesn't answer or the bus hangs from now on
+  <time> expect <text>             display has to start with the text (blank tubes on the left left out), like "7:30 lit"
+  <time> end                       run stops here
+
+Time is counted from the start of the run as [<days>d] HH:MM[:SS[.mmm]], lines may come in any order.
+*/
+
+/**
+ * Loads a script and schedules its actions
+ * @param path script file
+ * @param end set to the time of the end action, unchanged if there is none
+ * @return false if the file can't be read or a line isn't understood (the reason is printed)
+ */
+bool scriptLoad(const char *path, uint64_t &end);
+
+/**
+ * Formats a virtual time like script times, "1d 06:30:00.000"
+ * @param text where the text goes
+ * @param size size of text
+ * @param time virtual time (in nanoseconds)
+ */
+void scriptTimeText(char *text, size_t size, uint64_t time);
+
+// returns number of input changes so far (buttons, PIR sensor and serial data)
+unsigned long scriptInputs();
+
+// returns number of expect actions that passed
+int scriptPassed();
+
+// returns number of expect actions that failed
+int scriptFailed();
+
+#endif
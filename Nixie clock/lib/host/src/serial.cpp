@@ -0,0 +1,162 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <deque>
+#include "host.h"
+#include "host_internal.h"
+
+// USART and Print of the native build, serial data doesn't take virtual time (the USART sends in the background)
+
+const int max_listeners = 4;
+const uint8_t rx_pin = 0;
+
+HardwareSerial Serial;
+
+static std::deque<uint8_t> received;
+static void (*serialListeners[max_listeners])(uint8_t data);
+static int serialListenerCount = 0;
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  for (size_t i = 0; i < size; i++)
+    write(buffer[i]);
+  return size;
+}
+
+size_t Print::write(const char *text)
+{
+  return write((const uint8_t *)text, strlen(text));
+}
+
+size_t Print::print(const char *text)
+{
+  return write(text);
+}
+
+size_t Print::print(const __FlashStringHelper *text)
+{
+  return write(reinterpret_cast<const char *>(text));
+}
+
+size_t Print::print(char c)
+{
+  return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char value, int base)
+{
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(int value, int base)
+{
+  return print((long)value, base);
+}
+
+size_t Print::print(unsigned int value, int base)
+{
+  return print((unsigned long)value, base);
+}
+
+// negative numbers have a sign in decimal only, other bases print the 32 bit value like on the MCU
+size_t Print::print(long value, int base)
+{
+  if (base == DEC && value < 0)
+    return print('-') + print((unsigned long)-value, base);
+  return print((unsigned long)(uint32_t)value, base);
+}
+
+size_t Print::print(unsigned long value, int base)
+{
+  char text[33];
+  char *digit = text + sizeof(text) - 1;
+
+  if (base < 2)
+    base = DEC;
+  value = (uint32_t)value;
+  *digit = 0;
+  do
+  {
+    uint8_t remainder = value % base;
+
+    *--digit = remainder < 10 ? '0' + remainder : 'A' + remainder - 10;
+    value /= base;
+  } while (value);
+  return write(digit);
+}
+
+size_t Print::print(double value, int digits)
+{
+  char text[40];
+
+  snprintf(text, sizeof(text), "%.*f", digits, value);
+  return write(text);
+}
+
+size_t Print::println()
+{
+  return write("\r\n");
+}
+
+void HardwareSerial::begin(unsigned long)
+{
+  hostDrivePin(rx_pin, HIGH); // idle line
+}
+
+void HardwareSerial::end()
+{
+}
+
+int HardwareSerial::available()
+{
+  return min((int)received.size(), SERIAL_RX_BUFFER_SIZE - 1);
+}
+
+int HardwareSerial::peek()
+{
+  return received.empty() ? -1 : received.front();
+}
+
+int HardwareSerial::read()
+{
+  if (received.empty())
+    return -1;
+
+  uint8_t data = received.front();
+
+  received.pop_front();
+  return data;
+}
+
+int HardwareSerial::availableForWrite()
+{
+  return SERIAL_TX_BUFFER_SIZE - 1;
+}
+
+void HardwareSerial::flush()
+{
+}
+
+size_t HardwareSerial::write(uint8_t data)
+{
+  hostNoteActivity();
+  for (int i = 0; i < serialListenerCount; i++)
+    serialListeners[i](data);
+  return 1;
+}
+
+// the start bit pulls RX low, that is what wakes up a sleeping MCU
+void hostSerialInput(const uint8_t *data, int length)
+{
+  if (length <= 0)
+    return;
+
+  received.insert(received.end(), data, data + length);
+  hostDrivePin(rx_pin, LOW);
+  hostDrivePin(rx_pin, HIGH);
+}
+
+void hostOnSerialOutput(void (*listener)(uint8_t data))
+{
+  if (serialListenerCount < max_listeners)
+    serialListeners[serialListenerCount++] = listener;
+}
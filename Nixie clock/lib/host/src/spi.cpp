@@ -0,0 +1,55 @@
+#include <SPI.h>
+#include "host.h"
+#include "host_internal.h"
+
+// SPI master of the native build, bits are clocked out on the pins so they can be recorded
+
+const uint8_t ss_pin = 10, mosi_pin = 11, sck_pin = 13;
+
+SPIClass SPI;
+
+void SPIClass::begin()
+{
+  // SS has to be a high output, otherwise the MCU would become a slave
+  hostSetPortBit(ss_pin, HIGH);
+  pinMode(ss_pin, OUTPUT);
+  pinMode(mosi_pin, OUTPUT);
+  pinMode(sck_pin, OUTPUT);
+}
+
+void SPIClass::end()
+{
+}
+
+void SPIClass::beginTransaction(const SPISettings &settings)
+{
+  // the SPI clock is the CPU clock divided by 2, 4, ... 128, so it is never faster than asked for
+  uint32_t divided = 8000000;
+
+  while (divided > settings.clock && divided > 125000)
+    divided /= 2;
+  clock = divided;
+  bitOrder = settings.bitOrder;
+}
+
+void SPIClass::endTransaction()
+{
+}
+
+// mode 0: data is set while the clock is low and taken on its rising edge
+uint8_t SPIClass::transfer(uint8_t data)
+{
+  uint64_t halfPeriod = host_nanoseconds_per_second / clock / 2;
+
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    uint8_t bit = bitOrder == LSBFIRST ? i : 7 - i;
+
+    hostSetPortBit(mosi_pin, data & _BV(bit));
+    hostAdvance(halfPeriod);
+    hostSetPortBit(sck_pin, HIGH);
+    hostAdvance(halfPeriod);
+    hostSetPortBit(sck_pin, LOW);
+  }
+  return 0; // nothing is connected to MISO
+}
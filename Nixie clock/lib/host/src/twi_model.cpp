@@ -0,0 +1,161 @@
+#include <Arduino.h>
+#include <util/twi.h>
+#include "host.h"
+#include "host_internal.h"
+
+/*
+TWI master of the native build. Every bus event that a TWCR write starts (start condition, address or data byte)
+ends as many SCL periods later as it has bits on the bus, then TWSR gets its status, TWINT is set and the TWI
+interrupt is requested. The DS3231 is the only device on the bus, other addresses aren't acknowledged.
+hostI2cFault() makes the DS3231 disappear from the bus or the bus hang.
+*/
+
+const uint8_t ds3231_address = 0x68;
+const uint64_t register_time = 125; // two clocks
+
+// bus event that is running
+enum TwiEvent
+{
+  EVENT_START,
+  EVENT_ADDRESS,
+  EVENT_WRITE,
+  EVENT_READ
+};
+
+HostTwiControl TWCR;
+
+static uint8_t control = 0;
+static bool busOwned = false;   // start condition sent, no stop yet
+static bool addressNext = false; // next byte is an address
+static bool reading = false;    // master receiver mode
+static bool selected = false;   // DS3231 has acknowledged its address
+static uint8_t sentByte = 0;
+static bool acknowledge = false; // TWEA when a byte is received
+static long generation = 0;      // bus events of a TWI that has been turned off since are dropped
+static HostI2cFault fault = HOST_I2C_OK;
+
+// returns duration of a bit on the bus (in nanoseconds)
+static uint64_t bitTime()
+{
+  static const uint8_t prescalers[4] = {1, 4, 16, 64};
+
+  return host_nanoseconds_per_second * (16 + 2 * TWBR * prescalers[TWSR & 0x03]) / F_CPU;
+}
+
+static void eventDone(long event)
+{
+  if (event >> 2 != generation || fault == HOST_I2C_STUCK)
+    return;
+
+  uint8_t status;
+
+  switch (event & 0x03)
+  {
+  case EVENT_START:
+    status = busOwned ? TW_REP_START : TW_START;
+    busOwned = true;
+    addressNext = true;
+    break;
+
+  case EVENT_ADDRESS:
+    reading = sentByte & TW_READ;
+    selected = sentByte >> 1 == ds3231_address && fault == HOST_I2C_OK;
+    addressNext = false;
+    if (selected)
+      hostRtcI2cStart(reading);
+    if (reading)
+      status = selected ? TW_MR_SLA_ACK : TW_MR_SLA_NACK;
+    else
+      status = selected ? TW_MT_SLA_ACK : TW_MT_SLA_NACK;
+    break;
+
+  case EVENT_WRITE:
+    status = selected && hostRtcI2cWrite(sentByte) ? TW_MT_DATA_ACK : TW_MT_DATA_NACK;
+    break;
+
+  default:
+    TWDR = selected ? hostRtcI2cRead() : 0xFF; // released bus reads high
+    status = acknowledge ? TW_MR_DATA_ACK : TW_MR_DATA_NACK;
+    break;
+  }
+
+  TWSR = (TWSR & ~TW_STATUS_MASK) | status;
+  control |= _BV(TWINT);
+  hostRequestInterrupt(HOST_VECTOR_TWI);
+}
+
+static void stopDone(long event)
+{
+  if (event == generation)
+    control &= ~_BV(TWSTO);
+}
+
+static void startEvent(TwiEvent event, uint8_t bits)
+{
+  hostAt(hostNanos() + bits * bitTime(), eventDone, generation << 2 | event);
+}
+
+uint8_t hostTwiControl()
+{
+  return control;
+}
+
+void hostI2cFault(HostI2cFault newFault)
+{
+  fault = newFault;
+}
+
+HostTwiControl::operator uint8_t() const
+{
+  hostAdvance(register_time);
+  return control;
+}
+
+// writing TWINT clears it and starts the next bus event, other bits are just taken
+HostTwiControl &HostTwiControl::operator=(uint8_t value)
+{
+  hostNoteActivity();
+
+  if (!(value & _BV(TWEN)))
+  {
+    control = value & ~_BV(TWINT);
+    generation++;
+    busOwned = false;
+    selected = false;
+  }
+  else if (!(value & _BV(TWINT)))
+    control = (value & ~_BV(TWINT)) | (control & _BV(TWINT));
+  else
+  {
+    control = value & ~_BV(TWINT);
+    if (value & _BV(TWSTA))
+      startEvent(EVENT_START, 1);
+    else if (value & _BV(TWSTO))
+    {
+      if (selected)
+        hostRtcI2cStop();
+      busOwned = false;
+      selected = false;
+      TWSR = (TWSR & ~TW_STATUS_MASK) | TW_NO_INFO;
+      hostAt(hostNanos() + bitTime(), stopDone, generation);
+    }
+    else if (addressNext)
+    {
+      sentByte = TWDR;
+      startEvent(EVENT_ADDRESS, 9);
+    }
+    else if (reading)
+    {
+      acknowledge = value & _BV(TWEA);
+      startEvent(EVENT_READ, 9);
+    }
+    else
+    {
+      sentByte = TWDR;
+      startEvent(EVENT_WRITE, 9);
+    }
+  }
+
+  hostAdvance(register_time);
+  return *this;
+}
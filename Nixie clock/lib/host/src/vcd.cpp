@@ -0,0 +1,90 @@
+#include <Arduino.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "host.h"
+#include "pins.h"
+#include "vcd.h"
+
+struct Signal
+{
+  uint8_t pin;
+  const char *name;
+};
+
+static const Signal signals[] = {
+    {Board::Latch::number, "latch"},
+    {Board::MasterReset::number, "master_reset"},
+    {Board::Data::number, "data"},
+    {Board::Clock::number, "clock"},
+    {13, "sck"},
+    {Board::DisplayControl::number, "display_control"},
+    {Board::HourLed::number, "hour_led"},
+    {Board::MinuteLed::number, "minute_led"},
+    {Board::Button0::number, "button0"},
+    {Board::Button1::number, "button1"},
+    {Board::Button2::number, "button2"},
+    {Board::Sensor::number, "sensor"},
+    {Board::SquareWave::number, "square_wave"},
+    {Board::SerialRx::number, "serial_rx"},
+};
+
+const int signal_count = sizeof(signals) / sizeof(signals[0]);
+
+static FILE *file = nullptr;
+static int8_t signalOfPin[host_pin_count];
+static uint64_t lastTime = 0;
+
+// identifiers are single printable characters
+static char identifier(int signal)
+{
+  return '!' + signal;
+}
+
+static void pinChanged(uint8_t pin, bool level)
+{
+  if (!file || signalOfPin[pin] < 0)
+    return;
+
+  if (hostNanos() != lastTime)
+  {
+    lastTime = hostNanos();
+    fprintf(file, "#%" PRIu64 "\n", lastTime);
+  }
+  fprintf(file, "%d%c\n", level, identifier(signalOfPin[pin]));
+}
+
+bool vcdBegin(const char *path)
+{
+  file = fopen(path, "w");
+  if (!file)
+    return false;
+
+  memset(signalOfPin, -1, sizeof(signalOfPin));
+  fprintf(file, "$version nixie clock native build $end\n$timescale 1ns $end\n$scope module clock $end\n");
+  for (int i = 0; i < signal_count; i++)
+  {
+    signalOfPin[signals[i].pin] = i;
+    fprintf(file, "$var wire 1 %c %s $end\n", identifier(i), signals[i].name);
+  }
+  fprintf(file, "$upscope $end\n$enddefinitions $end\n");
+
+  lastTime = hostNanos();
+  fprintf(file, "#%" PRIu64 "\n$dumpvars\n", lastTime);
+  for (int i = 0; i < signal_count; i++)
+    fprintf(file, "%d%c\n", hostPinLevel(signals[i].pin), identifier(i));
+  fprintf(file, "$end\n");
+
+  hostOnPinChange(pinChanged);
+  return true;
+}
+
+void vcdEnd()
+{
+  if (!file)
+    return;
+
+  if (hostNanos() != lastTime)
+    fprintf(file, "#%" PRIu64 "\n", hostNanos());
+  fclose(file);
+  file = nullptr;
+}
@@ -0,0 +1,20 @@
+#ifndef VCD_H
+#define VCD_H
+
+/*
+Records pin levels of the native build to a VCD file (GTKWave, sigrok and tools/vcd_check.py read it).
+Pins carry the names of pins.h (latch, clock, data, ...), SCK (pin 13) is recorded too for the SPI backend.
+Times are virtual nanoseconds.
+*/
+
+/**
+ * Opens the file and writes the header with the current pin levels, every change is recorded from now on
+ * @param path VCD file
+ * @return false if the file can't be written
+ */
+bool vcdBegin(const char *path);
+
+// writes the end time and closes the file
+void vcdEnd();
+
+#endif
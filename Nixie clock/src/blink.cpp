@@ -0,0 +1,79 @@
+#include <Arduino.h>
+#include <util/atomic.h>
+#include "blink.h"
+#include "tick.h"
+
+static volatile byte blinkTubes = 0;
+static volatile byte blinkLedMask = 0;
+static volatile unsigned int halfPeriodTicks = 0; // 0 while nothing blinks
+static volatile unsigned int tickCounter = 0;
+static volatile bool blanked = false;
+static volatile bool phaseChanged = false;
+
+void blinkStart(byte tubes, byte leds, unsigned int halfPeriod)
+{
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    blinkTubes = tubes;
+    blinkLedMask = leds;
+    halfPeriodTicks = max(1, (int)(halfPeriod / tick_period));
+    tickCounter = 0;
+    blanked = false;
+    phaseChanged = true;
+  }
+}
+
+void blinkStop()
+{
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    halfPeriodTicks = 0;
+    blanked = false;
+    phaseChanged = true;
+  }
+}
+
+void blinkRestart()
+{
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    tickCounter = 0;
+    if (blanked)
+    {
+      blanked = false;
+      phaseChanged = true;
+    }
+  }
+}
+
+void blinkTick()
+{
+  if (halfPeriodTicks == 0 || ++tickCounter < halfPeriodTicks)
+    return;
+
+  tickCounter = 0;
+  blanked = !blanked;
+  phaseChanged = true;
+}
+
+bool blinkPhaseChanged()
+{
+  bool changed;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    changed = phaseChanged;
+    phaseChanged = false;
+  }
+  return changed;
+}
+
+byte blinkBlankMask()
+{
+  return blanked ? blinkTubes : 0;
+}
+
+byte blinkLeds()
+{
+  return blanked ? 0 : blinkLedMask;
+}
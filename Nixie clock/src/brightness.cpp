@@ -0,0 +1,99 @@
+#include <Arduino.h>
+#include "brightness.h"
+#include "pins.h"
+
+// PWM duty cycle for every brightness level, gamma 2.2
+static const byte gammaTable[brightness_levels] PROGMEM = {
+    0, 1, 2, 2, 4, 6, 8, 11, 14, 18, 22, 27, 32, 39, 45, 52,
+    60, 69, 78, 88, 98, 109, 120, 133, 146, 159, 173, 188, 204, 220, 237, 255};
+
+static byte onLevel = brightness_levels - 1;   // brightness when the display is on
+static volatile byte targetLevel = 0;          // brightness the display is fading to
+static volatile byte currentLevel = 0;         // brightness of the display right now
+static byte fadeDivider = 0;
+
+// beginning of every PWM period
+ISR(TIMER2_OVF_vect)
+{
+  Board::DisplayControl::high();
+}
+
+// end of the on time
+ISR(TIMER2_COMPA_vect)
+{
+  Board::DisplayControl::low();
+}
+
+// sets duty cycle of the display control pin, 0 and 255 turn interrupts off and hold the pin LOW or HIGH
+static void setDutyCycle(byte duty)
+{
+  if (duty == 0 || duty == 255)
+  {
+    TIMSK2 &= ~(_BV(TOIE2) | _BV(OCIE2A));
+    if (duty == 0)
+      Board::DisplayControl::low();
+    else
+      Board::DisplayControl::high();
+  }
+  else
+  {
+    OCR2A = duty; // double buffered, takes effect at the start of the next period
+    TIMSK2 |= _BV(TOIE2) | _BV(OCIE2A);
+  }
+}
+
+void brightnessBegin(byte level)
+{
+  Board::DisplayControl::output();
+  setBrightness(level);
+
+  // Timer2 in fast PWM mode, prescaler 64 -> 976Hz, OC2A and OC2B outputs stay disconnected (pins 11 and 3)
+  TCCR2A = _BV(WGM21) | _BV(WGM20);
+  TCCR2B = _BV(CS22);
+  setDutyCycle(0);
+}
+
+void setBrightness(byte level)
+{
+  if (level == 0)
+    level = 1;
+  if (level >= brightness_levels)
+    level = brightness_levels - 1;
+
+  onLevel = level;
+  if (targetLevel != 0)
+    targetLevel = level;
+}
+
+void turnDisplayOn()
+{
+  targetLevel = onLevel;
+}
+
+void turnDisplayOff()
+{
+  targetLevel = 0;
+}
+
+bool displayIsOn()
+{
+  return targetLevel != 0;
+}
+
+bool displayIsLit()
+{
+  return currentLevel != 0;
+}
+
+void brightnessTick()
+{
+  if (currentLevel == targetLevel || ++fadeDivider < fade_step_ticks)
+    return;
+
+  fadeDivider = 0;
+  if (currentLevel < targetLevel)
+    currentLevel++;
+  else
+    currentLevel--;
+  setDutyCycle(pgm_read_byte(&gammaTable[currentLevel]));
+}
@@ -0,0 +1,98 @@
+#include <Arduino.h>
+#include <util/atomic.h>
+#include "buttons.h"
+#include "pins.h"
+
+static volatile byte debouncedState = 0; // bit is 1 while the button is held down
+static volatile byte pressEdges = 0;     // buttons pressed since they were last reported
+static volatile byte releaseEdges = 0;   // buttons released since they were last reported
+static byte counter0 = 0xFF;             // bit 0 of every vertical counter
+static byte counter1 = 0xFF;             // bit 1 of every vertical counter
+static byte sampleTicks = 10;            // ticks between samples
+static byte sampleDivider = 0;
+
+void buttonsBegin(byte ticks)
+{
+  buttonPinsBegin();
+  sampleTicks = ticks;
+}
+
+void setButtonSampleTicks(byte ticks)
+{
+  sampleTicks = ticks;
+}
+
+void buttonsTick()
+{
+  if (++sampleDivider < sampleTicks)
+    return;
+
+  sampleDivider = 0;
+  sampleButtons();
+}
+
+void sampleButtons()
+{
+  debounceButtons(~readButtonPins() & button_mask); // buttons have pullups, pressed button reads LOW
+}
+
+void debounceButtons(byte pressed)
+{
+  // count samples that differ from debounced state, counter restarts when they are equal
+  byte changed = debouncedState ^ pressed;
+  counter0 = ~(counter0 & changed);
+  counter1 = counter0 ^ (counter1 & changed);
+
+  // buttons whose counters rolled over have been stable for 4 samples
+  changed &= counter0 & counter1;
+  debouncedState ^= changed;
+  pressEdges |= debouncedState & changed;
+  releaseEdges |= ~debouncedState & changed;
+}
+
+bool buttonPressed(int buttonIndex)
+{
+  byte mask = 1 << buttonIndex;
+  bool pressed;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    pressed = pressEdges & mask;
+    pressEdges &= ~mask;
+  }
+  return pressed;
+}
+
+byte buttonPresses()
+{
+  byte presses;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    presses = pressEdges;
+    pressEdges = 0;
+  }
+  return presses;
+}
+
+byte buttonReleases()
+{
+  byte releases;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    releases = releaseEdges;
+    releaseEdges = 0;
+  }
+  return releases;
+}
+
+byte buttonsDown()
+{
+  return debouncedState;
+}
+
+bool buttonsBusy()
+{
+  return (~readButtonPins() & button_mask) || debouncedState;
+}
@@ -0,0 +1,93 @@
+#include <Arduino.h>
+#include "calibration.h"
+#include "pins.h"
+#include "timekeeper.h"
+
+const long one_second = 1000000;
+
+static volatile bool captureArmed = false;
+static volatile bool captured = false;
+static volatile unsigned long startBitMicros = 0;
+static volatile unsigned long startBitTicks = 0;
+static volatile unsigned long startBitEdge = 0; // micros() of the second edge before the start bit
+static unsigned long sessionStart = 0;
+static bool session = false;
+
+/*
+Port D pin change interrupt, pins of port D only wake the MCU up (see power.cpp) except for the RX pin while the
+capture is armed: the line is idle then, so the first change is the start bit of the next frame
+*/
+ISR(PCINT2_vect)
+{
+  if (!captureArmed)
+    return;
+
+  unsigned long ticks, edge;
+
+  startBitMicros = micros();
+  lastSecondEdge(ticks, edge);
+  startBitTicks = ticks;
+  startBitEdge = edge;
+  captureArmed = false;
+  captured = true;
+  Board::SerialRx::disablePinChange();
+}
+
+void calibrationArm()
+{
+  session = true;
+  sessionStart = millis();
+  captured = false;
+  captureArmed = true;
+  Board::SerialRx::enablePinChange();
+}
+
+bool calibrationActive()
+{
+  if (session && millis() - sessionStart >= calibration_session_time)
+    session = false;
+  return session;
+}
+
+// returns true if the start bit of the frame that was just received was taken, it is used only once
+static bool takeStartBit()
+{
+  bool taken = captured && !captureArmed;
+
+  captured = false;
+  return taken;
+}
+
+bool calibrationMark(uint32_t referenceMicros, CalibrationMark &mark)
+{
+  if (!takeStartBit())
+    return false;
+
+  long offset = ((long)referenceMicros - (long)(startBitMicros - startBitEdge)) % one_second;
+
+  if (offset < -one_second / 2)
+    offset += one_second;
+  else if (offset >= one_second / 2)
+    offset -= one_second;
+
+  mark.ticks = startBitTicks;
+  mark.phase = startBitMicros - startBitEdge;
+  mark.offset = offset;
+  return true;
+}
+
+bool setRtcTimeAligned(const RtcTime &time, uint32_t delay)
+{
+  if (!takeStartBit() || delay > max_set_delay || delay < ds3231_set_latency ||
+      micros() - startBitMicros > delay - ds3231_set_latency)
+    return false;
+
+  // a background read of the RTC would hold the write back, the countdown chain is reset ds3231_set_latency
+  // after the write starts
+  while (ds3231ReadBusy())
+    continue;
+  while (micros() - startBitMicros < delay - ds3231_set_latency)
+    continue;
+  setRtcDateTime(time.year, time.month, time.day, time.hour, time.minute, time.second);
+  return true;
+}
@@ -0,0 +1,161 @@
+#include <Arduino.h>
+#include "cathode_routine.h"
+#include "display.h"
+#include "log.h"
+#include "wear.h"
+
+const int sweep_steps = 18; // digits 0...9 and back 8...1
+
+static bool running = false;
+static bool adaptive = false;          // running adaptive routine instead of sweeps
+static int step = 0;                   // position in the current sweep
+static unsigned long startTime = 0;    // when the routine was started
+static unsigned long stepTime = 0;     // when the current digit was shown
+static unsigned long routineInterval = 0;
+static unsigned long routineDigitDelay = 0;
+static byte debt[tube_count][10];      // how many more steps every cathode gets in adaptive routine
+
+/**
+ * Lights up the same digit on every tube
+ * @param digit digit to be displayed (0...9)
+ */
+static void showDigitOnAllTubes(byte digit)
+{
+  byte digits[tube_count];
+
+  memset(digits, digit, tube_count);
+  displayDigits(digits, false);
+}
+
+/**
+ * Lights up the cathode with the largest remaining debt on every tube, tubes with no debt are blank
+ * @return false if no tube has any debt left
+ */
+static bool showMostIndebtedCathodes()
+{
+  byte digits[tube_count];
+  bool indebted = false;
+
+  for (int i = 0; i < tube_count; i++)
+  {
+    digits[i] = 0xFF;
+    for (int j = 0; j < 10; j++)
+    {
+      if (debt[i][j] != 0 && (digits[i] == 0xFF || debt[i][j] > debt[i][digits[i]]))
+        digits[i] = j;
+    }
+    if (digits[i] != 0xFF)
+    {
+      debt[i][digits[i]]--;
+      indebted = true;
+    }
+  }
+
+  if (indebted)
+    displayDigits(digits, false);
+  return indebted;
+}
+
+void startCathodeRoutine(const unsigned long timeInterval, const unsigned long digitDelay)
+{
+  routineInterval = timeInterval;
+  routineDigitDelay = digitDelay;
+  startTime = millis();
+  stepTime = startTime;
+  step = 0;
+  adaptive = false;
+  running = true;
+  showDigitOnAllTubes(0);
+}
+
+void startAdaptiveCathodeRoutine(const unsigned long timeInterval, const unsigned long digitDelay)
+{
+  const unsigned long steps = timeInterval / digitDelay; // steps every tube gets
+  bool indebted = false;
+
+  for (int i = 0; i < tube_count; i++)
+  {
+    unsigned long mostUsed = 0;
+    unsigned long totalDeficit = 0;
+
+    for (int j = 0; j < 10; j++)
+      mostUsed = max(mostUsed, cathodeUsage(i, j));
+    for (int j = 0; j < 10; j++)
+      totalDeficit += mostUsed - cathodeUsage(i, j);
+
+    // steps are shared between cathodes in proportion to how far behind the most used cathode they are
+    for (int j = 0; j < 10; j++)
+    {
+      unsigned long cathodeSteps = 0;
+
+      if (totalDeficit != 0)
+        cathodeSteps = (float)steps * (mostUsed - cathodeUsage(i, j)) / totalDeficit + 0.5;
+      debt[i][j] = min(cathodeSteps, 255UL);
+      indebted |= debt[i][j] != 0;
+    }
+  }
+
+  // all cathodes are equally used (e.g. no statistics yet), one ordinary sweep is done
+  if (!indebted)
+  {
+    startCathodeRoutine(0, digitDelay);
+    return;
+  }
+
+  routineInterval = timeInterval;
+  routineDigitDelay = digitDelay;
+  startTime = millis();
+  stepTime = startTime;
+  adaptive = true;
+  running = true;
+  showMostIndebtedCathodes();
+}
+
+bool cathodeRoutineStep()
+{
+  if (!running)
+    return false;
+
+  unsigned long currentTime = millis();
+
+  if (currentTime - stepTime < routineDigitDelay)
+    return true;
+
+  stepTime = currentTime;
+
+  if (adaptive)
+  {
+    if (!showMostIndebtedCathodes())
+    {
+      running = false;
+      log_info("adaptive cathode routine has completed");
+    }
+    return running;
+  }
+
+  step++;
+  if (step == sweep_steps)
+  {
+    // a sweep has been completed, check if the routine has run long enough
+    if (currentTime - startTime > routineInterval)
+    {
+      running = false;
+      log_info("cathode routine has completed");
+      return false;
+    }
+    step = 0;
+  }
+
+  showDigitOnAllTubes(step < 10 ? step : sweep_steps - step);
+  return true;
+}
+
+void stopCathodeRoutine()
+{
+  running = false;
+}
+
+bool cathodeRoutineRunning()
+{
+  return running;
+}
@@ -0,0 +1,25 @@
+#include <Arduino.h>
+#include "console.h"
+#include "occupancy.h"
+#include "wear.h"
+
+void consoleCommand(char command)
+{
+  switch (command)
+  {
+#if PROFILING == 1
+  case 'p':
+    printProfile();
+    break;
+  case 'r':
+    resetProfile();
+    break;
+#endif
+  case 'w':
+    printWearStatistics();
+    break;
+  case 'o':
+    printOccupancy();
+    break;
+  }
+}
@@ -0,0 +1,169 @@
+#include <Arduino.h>
+#include <util/atomic.h>
+#include "display.h"
+
+volatile unsigned long framesLatched = 0;
+volatile unsigned long framesSkipped = 0;
+
+static byte latchedFrame[frame_bytes]; // frame which is currently on the shift register outputs
+static bool latchedFrameValid = false;
+static byte armedFrame[frame_bytes];       // frame which is in the shift registers, waiting to be latched
+static bool armedFrameLoaded = false;       // armed frame is still in the shift registers
+static volatile bool frameArmed = false;    // armed frame may be latched from an interrupt
+static volatile bool displayBusy = false;   // main loop is updating the display
+
+/*
+Position of every cathode in the frame, tubes are shifted out from right to left (minute2 first),
+so cathode of the digit d on the tube t (counted from the left) is the bit (tube_count - 1 - t) * 10 + d,
+neon n is the bit tube_count * 10 + n
+*/
+#define CATHODE_BIT(tube, digit) ((tube_count - 1 - (tube)) * 10 + (digit))
+#define CATHODE_BYTE(tube, digit) (CATHODE_BIT(tube, digit) / 8)
+#define CATHODE_MASK(tube, digit) (1 << (CATHODE_BIT(tube, digit) % 8))
+
+#define TUBE_CATHODES(field, tube)                                                   \
+  {                                                                                  \
+    field(tube, 0), field(tube, 1), field(tube, 2), field(tube, 3), field(tube, 4), \
+        field(tube, 5), field(tube, 6), field(tube, 7), field(tube, 8), field(tube, 9) \
+  }
+
+static const byte cathodeByte[tube_count][10] PROGMEM = {
+    TUBE_CATHODES(CATHODE_BYTE, 0), TUBE_CATHODES(CATHODE_BYTE, 1),
+    TUBE_CATHODES(CATHODE_BYTE, 2), TUBE_CATHODES(CATHODE_BYTE, 3),
+#if TUBE_COUNT == 6
+    TUBE_CATHODES(CATHODE_BYTE, 4), TUBE_CATHODES(CATHODE_BYTE, 5),
+#endif
+};
+
+static const byte cathodeMask[tube_count][10] PROGMEM = {
+    TUBE_CATHODES(CATHODE_MASK, 0), TUBE_CATHODES(CATHODE_MASK, 1),
+    TUBE_CATHODES(CATHODE_MASK, 2), TUBE_CATHODES(CATHODE_MASK, 3),
+#if TUBE_COUNT == 6
+    TUBE_CATHODES(CATHODE_MASK, 4), TUBE_CATHODES(CATHODE_MASK, 5),
+#endif
+};
+
+void encodeFrame(byte *frame, const byte *digits, byte blankMask, byte neonMask)
+{
+  memset(frame, 0, frame_bytes);
+
+  for (int i = 0; i < tube_count; i++)
+  {
+    if (!(blankMask & (1 << i)) && digits[i] < 10)
+      frame[pgm_read_byte(&cathodeByte[i][digits[i]])] |= pgm_read_byte(&cathodeMask[i][digits[i]]);
+  }
+
+  for (int i = 0; i < neon_count; i++)
+  {
+    if (neonMask & (1 << i))
+      frame[(tube_count * 10 + i) / 8] |= 1 << ((tube_count * 10 + i) % 8);
+  }
+}
+
+bool displayDigits(const byte *digits, byte blankMask, byte neonMask)
+{
+  byte frame[frame_bytes];
+
+  encodeFrame(frame, digits, blankMask, neonMask);
+  return displayFrame(frame);
+}
+
+bool displayFrame(const byte *frame)
+{
+  displayBusy = true;
+  frameArmed = false; // armed frame is overwritten, interrupt musn't latch in the middle of shifting
+  armedFrameLoaded = false;
+
+  bool changed = !latchedFrameValid || memcmp(frame, latchedFrame, frame_bytes) != 0;
+
+  if (changed)
+  {
+    shiftOutFrame(frame);
+    memcpy(latchedFrame, frame, frame_bytes);
+    latchedFrameValid = true;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+      framesLatched++;
+    }
+  }
+  else
+  {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+      framesSkipped++;
+    }
+  }
+
+  displayBusy = false;
+  return changed;
+}
+
+bool armFrame(const byte *frame)
+{
+  displayBusy = true;
+  frameArmed = false;
+
+  if (latchedFrameValid && memcmp(frame, latchedFrame, frame_bytes) == 0)
+  {
+    displayBusy = false;
+    return false;
+  }
+
+  // only shift the frame out if it isn't already waiting in the shift registers
+  if (!armedFrameLoaded || memcmp(frame, armedFrame, frame_bytes) != 0)
+  {
+    shiftFrame(frame);
+    memcpy(armedFrame, frame, frame_bytes);
+    armedFrameLoaded = true;
+  }
+  frameArmed = true;
+  displayBusy = false;
+  return true;
+}
+
+void disarmFrame()
+{
+  frameArmed = false;
+}
+
+bool latchArmedFrame()
+{
+  if (!frameArmed)
+    return false;
+
+  latchFrame();
+  memcpy(latchedFrame, armedFrame, frame_bytes);
+  latchedFrameValid = true;
+  frameArmed = false;
+  armedFrameLoaded = false;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    framesLatched++;
+  }
+  return true;
+}
+
+bool getDisplayedDigits(byte *digits)
+{
+  if (displayBusy || !latchedFrameValid)
+    return false;
+
+  for (int i = 0; i < tube_count; i++)
+  {
+    digits[i] = 0xFF;
+    for (int j = 0; j < 10; j++)
+    {
+      if (latchedFrame[pgm_read_byte(&cathodeByte[i][j])] & pgm_read_byte(&cathodeMask[i][j]))
+      {
+        digits[i] = j;
+        break;
+      }
+    }
+  }
+  return true;
+}
+
+void invalidateDisplay()
+{
+  latchedFrameValid = false;
+}
@@ -0,0 +1,178 @@
+#include <Arduino.h>
+#include "ds3231.h"
+#include "twi.h"
+
+const byte ds3231_address = 0x68;
+const byte time_register = 0x00; // seconds, minutes, hours, day of week, date, month, year
+const byte control_register = 0x0E;
+const byte status_register = 0x0F;
+const byte aging_offset_register = 0x10;
+const byte time_registers = 7;
+
+// control and status bits
+const byte INTCN = 2; // control: alarm interrupt instead of square wave
+const byte RS1 = 3;   // control: square wave frequency, 0 is 1Hz
+const byte RS2 = 4;
+const byte CONV = 5; // control: start temperature conversion
+const byte BSY = 2;  // status: temperature conversion running
+const byte OSF = 7;  // status: oscillator has stopped
+
+static byte readRegisters[time_registers]; // background read
+static volatile bool readRunning = false;
+static volatile bool readOk = false;
+static void (*readDone)() = nullptr;
+
+static byte fromBcd(byte value)
+{
+  return (value >> 4) * 10 + (value & 0x0F);
+}
+
+static byte toBcd(byte value)
+{
+  return (value / 10) << 4 | value % 10;
+}
+
+static void decodeTime(const byte *registers, RtcTime &time)
+{
+  time.second = fromBcd(registers[0] & 0x7F);
+  time.minute = fromBcd(registers[1] & 0x7F);
+  time.hour = fromBcd(registers[2] & 0x3F); // 24 hour mode
+  time.day = fromBcd(registers[4] & 0x3F);
+  time.month = fromBcd(registers[5] & 0x1F);
+  time.year = 2000 + fromBcd(registers[6]);
+}
+
+// every fourth year is a leap year from 2000 to 2099 (2000 is one as well)
+static bool leapYear(int year)
+{
+  return year % 4 == 0;
+}
+
+// 2000-01-01 was a Saturday
+byte dayOfWeek(int year, byte month, byte day)
+{
+  static const unsigned int days_before_month[] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+  int years = year - 2000;
+  unsigned int days = years * 365 + (years + 3) / 4 + days_before_month[month - 1] + day - 1;
+
+  if (month > 2 && leapYear(year))
+    days++;
+  return (days + 5) % 7 + 1;
+}
+
+byte daysInMonth(int year, byte month)
+{
+  static const byte days_in_month[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+  return month == 2 && leapYear(year) ? 29 : days_in_month[month - 1];
+}
+
+static bool readRegister(byte address, byte &value)
+{
+  twiWait();
+  return twiStartRead(ds3231_address, address, &value, 1) && twiWait();
+}
+
+static bool writeRegister(byte address, byte value)
+{
+  twiWait();
+  return twiStartWrite(ds3231_address, address, &value, 1) && twiWait();
+}
+
+bool ds3231Begin()
+{
+  byte status;
+
+  twiBegin(ds3231_i2c_frequency);
+  return readRegister(status_register, status);
+}
+
+bool ds3231Read(RtcTime &time)
+{
+  byte registers[time_registers];
+
+  twiWait();
+  if (!twiStartRead(ds3231_address, time_register, registers, time_registers) || !twiWait())
+    return false;
+  decodeTime(registers, time);
+  return true;
+}
+
+// end of a background read, runs in the TWI interrupt
+static void readFinished()
+{
+  readOk = twiResult() == TWI_OK;
+  readRunning = false;
+  if (readDone)
+    readDone();
+}
+
+bool ds3231StartRead(void (*done)())
+{
+  if (readRunning)
+    return false;
+
+  readDone = done;
+  readRunning = true;
+  if (twiStartRead(ds3231_address, time_register, readRegisters, time_registers, readFinished))
+    return true;
+
+  readRunning = false;
+  return false;
+}
+
+// the TWI is polled (not only the flag), so waiting loops see the bus like on the MCU in the native build as well
+bool ds3231ReadBusy()
+{
+  return readRunning && twiBusy();
+}
+
+bool ds3231ReadResult(RtcTime &time)
+{
+  if (readRunning || !readOk)
+    return false;
+
+  decodeTime(readRegisters, time);
+  return true;
+}
+
+// the countdown chain is reset when the seconds register is written, the oscillator stop flag is cleared after it
+void ds3231Write(const RtcTime &time)
+{
+  byte registers[time_registers] = {toBcd(time.second), toBcd(time.minute), toBcd(time.hour),
+                                    dayOfWeek(time.year, time.month, time.day), toBcd(time.day),
+                                    toBcd(time.month), toBcd(time.year - 2000)};
+  byte status;
+
+  twiWait();
+  if (twiStartWrite(ds3231_address, time_register, registers, time_registers) && twiWait() &&
+      readRegister(status_register, status))
+    writeRegister(status_register, status & ~_BV(OSF));
+}
+
+void ds3231EnableSquareWave()
+{
+  byte control;
+
+  if (readRegister(control_register, control))
+    writeRegister(control_register, control & ~(_BV(INTCN) | _BV(RS1) | _BV(RS2)));
+}
+
+int8_t ds3231ReadAgingOffset()
+{
+  byte offset = 0;
+
+  readRegister(aging_offset_register, offset);
+  return (int8_t)offset;
+}
+
+void ds3231WriteAgingOffset(int8_t offset)
+{
+  byte status, control;
+
+  writeRegister(aging_offset_register, offset);
+
+  // a conversion that is already running applies it as well
+  if (readRegister(status_register, status) && !(status & _BV(BSY)) && readRegister(control_register, control))
+    writeRegister(control_register, control | _BV(CONV));
+}
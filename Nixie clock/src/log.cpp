@@ -0,0 +1,233 @@
+#include <Arduino.h>
+#include <util/atomic.h>
+#include "log.h"
+
+#if LOG_LEVEL > LOG_LEVEL_NONE
+
+const byte ring_mask = log_buffer_size - 1;
+
+// ring of events: format string address, number of arguments, arguments
+static byte ring[log_buffer_size];
+static volatile byte head = 0; // next byte to be written
+static volatile byte tail = 0; // next byte to be read
+static volatile unsigned int droppedEvents = 0;
+
+// line that is being written to serial
+static char line[log_line_size];
+static byte lineLength = 0;
+static byte linePosition = 0;
+
+// copies bytes into the ring, there has to be enough room
+static void ringWrite(const void *data, byte size)
+{
+  const byte *bytes = (const byte *)data;
+
+  for (byte i = 0; i < size; i++)
+  {
+    ring[head] = bytes[i];
+    head = (head + 1) & ring_mask;
+  }
+}
+
+// copies bytes out of the ring, they have to be there
+static void ringRead(void *data, byte size)
+{
+  byte *bytes = (byte *)data;
+
+  for (byte i = 0; i < size; i++)
+  {
+    bytes[i] = ring[tail];
+    tail = (tail + 1) & ring_mask;
+  }
+}
+
+static void storeEvent(const char *format, byte count, const long *arguments)
+{
+  byte size = sizeof(format) + 1 + count * sizeof(long);
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    byte used = (head - tail) & ring_mask;
+
+    if (log_buffer_size - 1 - used < size)
+      droppedEvents++;
+    else
+    {
+      ringWrite(&format, sizeof(format));
+      ringWrite(&count, 1);
+      ringWrite(arguments, count * sizeof(long));
+    }
+  }
+}
+
+void logEvent(const char *format)
+{
+  storeEvent(format, 0, NULL);
+}
+
+void logEvent(const char *format, long a)
+{
+  storeEvent(format, 1, &a);
+}
+
+void logEvent(const char *format, long a, long b)
+{
+  const long arguments[] = {a, b};
+
+  storeEvent(format, 2, arguments);
+}
+
+void logEvent(const char *format, long a, long b, long c)
+{
+  const long arguments[] = {a, b, c};
+
+  storeEvent(format, 3, arguments);
+}
+
+// adds a character to the line, leaving room for the line ending
+static void append(char c)
+{
+  if (lineLength < log_line_size - 2)
+    line[lineLength++] = c;
+}
+
+/**
+ * Adds a number to the line
+ * @param value number to add
+ * @param base 10 or 16
+ * @param isSigned value is printed as signed
+ * @param width minimal number of characters, padded with pad
+ * @param pad padding character
+ */
+static void appendNumber(long value, byte base, bool isSigned, byte width, char pad)
+{
+  char digits[11];
+  byte count = 0;
+  bool negative = isSigned && value < 0;
+  unsigned long number = negative ? -(unsigned long)value : (unsigned long)value;
+
+  do
+  {
+    byte digit = number % base;
+    digits[count++] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    number /= base;
+  } while (number != 0);
+
+  if (negative && pad == '0')
+    append('-');
+  for (byte i = count + negative; i < width; i++)
+    append(pad);
+  if (negative && pad != '0')
+    append('-');
+  while (count > 0)
+    append(digits[--count]);
+}
+
+// formats an event from flash format string and its arguments into the line
+static void formatLine(const char *format, byte count, const long *arguments)
+{
+  byte argument = 0;
+  char c;
+
+  lineLength = 0;
+  while ((c = pgm_read_byte(format++)) != '\0')
+  {
+    if (c != '%')
+    {
+      append(c);
+      continue;
+    }
+
+    char pad = ' ';
+    byte width = 0;
+
+    c = pgm_read_byte(format++);
+    if (c == '0')
+    {
+      pad = '0';
+      c = pgm_read_byte(format++);
+    }
+    while (c >= '0' && c <= '9')
+    {
+      width = width * 10 + c - '0';
+      c = pgm_read_byte(format++);
+    }
+
+    if (c == '%')
+      append('%');
+    else if (c == '\0')
+      break;
+    else if (argument < count)
+    {
+      long value = arguments[argument++];
+
+      if (c == 'd')
+        appendNumber(value, 10, true, width, pad);
+      else if (c == 'x')
+        appendNumber(value, 16, false, width, pad);
+      else
+        appendNumber(value, 10, false, width, pad);
+    }
+  }
+  line[lineLength++] = '\r';
+  line[lineLength++] = '\n';
+  linePosition = 0;
+}
+
+// formats the next event into the line, returns false if there isn't any
+static bool nextLine()
+{
+  // events are only removed here, so the whole event can be read without blocking interrupts
+  if (head != tail)
+  {
+    const char *format;
+    byte count;
+    long arguments[log_max_arguments];
+
+    ringRead(&format, sizeof(format));
+    ringRead(&count, 1);
+    ringRead(arguments, count * sizeof(long));
+    formatLine(format, count, arguments);
+    return true;
+  }
+
+  // events were dropped after the ones that were in the ring
+  long dropped;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    dropped = droppedEvents;
+    droppedEvents = 0;
+  }
+  if (dropped == 0)
+    return false;
+
+  formatLine(PSTR("%u log events dropped"), 1, &dropped);
+  return true;
+}
+
+void logFlush()
+{
+  while (true)
+  {
+    if (linePosition == lineLength && !nextLine())
+      return;
+
+    int room = Serial.availableForWrite();
+
+    while (room > 0 && linePosition < lineLength)
+    {
+      Serial.write(line[linePosition++]);
+      room--;
+    }
+    if (linePosition < lineLength)
+      return;
+  }
+}
+
+bool logIdle()
+{
+  return head == tail && linePosition == lineLength && droppedEvents == 0;
+}
+
+#endif
@@ -1,385 +1,368 @@
 #include <Arduino.h>
-#include <Wire.h>
-#include <RTClib.h>
-
-// debugging
-#define DEBUG 0 // choose to debug or not; 1 is debugging 0 is not
-
-#if DEBUG == 1
-#define debug(x) Serial.print(x)
-#define debugln(x) Serial.println(x)
-#define debug_begin(x) Serial.begin(x)
-#else
-#define debug(x)
-#define debugln(x)
-#define debug_begin(x)
-#endif
-
-// Control variables:
-const int number_of_buttons = 3;                    // number of buttons connected
-const int button[number_of_buttons] = {6, 7, 8};    // array that stores button pins
-int buttonState[number_of_buttons] = {1, 1, 1};     // array that stores initial button states
-int lastButtonState[number_of_buttons] = {1, 1, 1}; // array that stores last button states
-int setupMode = 0;                                  // variable which saves the current value of setup mode
-
-// Variables for controling shift registers and indicator leds:
-const int latchPin = 9;     // Pin connected to RCK of TPIC6B595
-const int masterReset = 10; // Pin connected to SRCLR of all TPIC6B595 IC-s
-const int dataPin = 11;     // Pin connected to SERIAL IN of TPIC6B595
-const int clockPin = 12;    // Pin connected to SRCK of TPIC6B595
-const int hourLed = 4;      // Pin connected a led that will light up when adjusting hours
-const int minuteLed = 5;    // Pin connected a led that will light up whem adjusting minutes
-int hourLedState = HIGH;    // variable that stores current hourLed state
-int minuteLedState = HIGH;  // variable that stores current minuteLed state
+#include "pins.h"
+#include "power.h"
+#include "profiler.h"
+#include "protocol.h"
+#include "settings.h"
+#include "brightness.h"
+#include "buttons.h"
+#include "cathode_routine.h"
+#include "display.h"
+#include "ds3231.h"
+#include "log.h"
+#include "menu.h"
+#include "occupancy.h"
+#include "shift_register.h"
+#include "tick.h"
+#include "timekeeper.h"
+#include "transitions.h"
+#include "wear.h"
 
 // motion detection Variables
-const int sensorPin = 3;
-const int displayControlPin = 2;
 unsigned long previousTime = 0;
+bool prelit = false; // display was lit ahead of a habitually occupied time and there was no motion since
 
 // Timing variables:
 int minuteCounter = -1;
 int minuteChange = 100; // set to 100 so that it's impossible for minute value to be same as minute change during startup
 int hour, minute, second;
-int hour1, hour2, minute1, minute2;
+int adjustedHour, adjustedMinute; // time that is being adjusted in setup mode
+long armedTime = -1;                // time of the frame that waits in the shift registers (seconds since midnight)
+int secondChange = -1;
 
-// define values for blanking digits
-#define hour_1 1
-#define hour_2 2
-#define minute_1 3
-#define minute_2 4
+const long seconds_per_day = 86400;
 
-RTC_DS3231 rtc;
+// seconds are displayed on 6 tubes and neons blink, either way the display changes every second
+const bool second_updates = tube_count == 6 || neon_count > 0;
 
 /**
- * Function for debouncing multiple buttons
- * @param buttonIndex the index of the button array to be read (button pins are storred in array)
- * @param debounceDelay time to delay between bounces (in milliseconds)
+ * Separates time into digits of every tube
+ * @param digits digits of every tube from left to right
+ * @param hours hour value
+ * @param minutes minute value
+ * @param seconds second value (only displayed on 6 tubes)
+ * @return which digits are blanked
  */
-bool debouncedButtonRead(int buttonIndex, const unsigned long debounceDelay)
+byte timeDigits(byte *digits, int hours, int minutes, int seconds)
 {
-  // Read the state of the button pin into a local variable:
-  int reading = digitalRead(button[buttonIndex]);
-
-  // Local variable used to store time between button pin state changes:
-  unsigned long previousTime;
-
-  /*
-  Check to see if you just pressed the button
-  (i.e. the input went from HIGH to LOW), and you've waited long enough
-  since the last press to ignore any noise:
-  */
-  // If button state changed, due to noise or pressing:
-  if (reading != lastButtonState[buttonIndex])
-    previousTime = millis(); // reset the debouncing timer
-
-  if ((millis() - previousTime) > debounceDelay)
-  {
-    /*
-    Whatever the reading is at, it's been there for longer than the debounce
-    delay, so take it as the actual current state:
-    */
-
-    // If the button state has changed:
-    if (reading != buttonState[buttonIndex])
-    {
-      buttonState[buttonIndex] = reading;
-
-      if (buttonState[buttonIndex] == LOW) // only return true if buttin state is LOW, change this to HIGH if you have pulldown resistors on button pins
-        return true;
-    }
-  }
-
-  // Save the reading. Next time through the loop, it'll be the lastButtonState:
-  lastButtonState[buttonIndex] = reading;
-  return false;
+  digits[0] = hours / 10;
+  digits[1] = hours % 10;
+  digits[2] = minutes / 10;
+  digits[3] = minutes % 10;
+#if TUBE_COUNT == 6
+  digits[4] = seconds / 10;
+  digits[5] = seconds % 10;
+#else
+  (void)seconds;
+#endif
+  return hours < 10 ? hour_1 : 0; // blank first hour digit when time is 04:00 --> 4:00
 }
 
 /**
- * function for shifting out the nth bit into the storage register (value determines which bit)
- * @param dataPin pin connected to serial data input for shift registers
- * @param clockPin clock pin connected to clock input for shift registers
- * @param bitOrder order of bits (LSB, MSB)
- * @param value sequential bit number to be shifted out
- * @param bits number of bits to shift out
- * @param enableBlanking when this is enabled all bitts that are shifted out will be zeroes (no digit will light up)
+ * Returns which neons are lit at the given second, they blink like a colon
+ * @param seconds second value
  */
-void shiftOutBits(int dataPin, int clockPin, int bitOrder, int value, int bits, bool enableBlanking)
+byte timeNeons(int seconds)
 {
-  if (enableBlanking == false)
-  {
-    for (int i = 0; i < bits; i++)
-    {
-      if (bitOrder == LSBFIRST)
-        digitalWrite(dataPin, (i == value));
-      else
-        digitalWrite(dataPin, (bits - 1 - i) == value);
-
-      digitalWrite(clockPin, HIGH);
-      digitalWrite(clockPin, LOW);
-    }
-  }
-  else
-  {
-    digitalWrite(dataPin, LOW);
-    for (int i = 0; i < bits; i++)
-    {
-      digitalWrite(clockPin, HIGH);
-      digitalWrite(clockPin, LOW);
-    }
-  }
+  return seconds % 2 == 0 ? all_neons : 0;
 }
 
 /**
- * This function updates displayed time
- * @param blankDigit which digit is blanked (put "false" if no digits are to be blanked)
+ * Displays time, nothing is shifted out if the time on the display is already the same
+ * @param hours hour value to be displayed
+ * @param minutes minute value to be displayed
+ * @param seconds second value to be displayed
+ * @return true if displayed time has changed
  */
-void updateDisplayedTime(int blankDigit)
+bool showTime(int hours, int minutes, int seconds)
 {
-  digitalWrite(latchPin, LOW);
-  shiftOutBits(dataPin, clockPin, LSBFIRST, minute2, 10, blankDigit == minute_2);
-  shiftOutBits(dataPin, clockPin, LSBFIRST, minute1, 10, blankDigit == minute_1);
-  shiftOutBits(dataPin, clockPin, LSBFIRST, hour2, 10, blankDigit == hour_2);
-  shiftOutBits(dataPin, clockPin, LSBFIRST, hour1, 10, blankDigit == hour_1);
-  digitalWrite(latchPin, HIGH);
+  byte digits[tube_count];
+  byte blankMask = timeDigits(digits, hours, minutes, seconds);
+
+  return displayDigits(digits, blankMask, timeNeons(seconds));
 }
 
-// Function for calculating first and last hour digit, first and last minute digit
-void calculateTime()
+/**
+ * Shifts out time without displaying it, it is latched on the next RTC second edge
+ * @param time time to be displayed next (seconds since midnight)
+ */
+void armTime(long time)
 {
-  // separate first and second digit of hour value
-  hour1 = hour / 10;
-  hour2 = hour % 10;
+  byte frame[frame_bytes];
+  byte digits[tube_count];
+  byte blankMask = timeDigits(digits, time / 3600, time / 60 % 60, time % 60);
 
-  // separate first and second digit of minute value
-  minute1 = minute / 10;
-  minute2 = minute % 10;
+  encodeFrame(frame, digits, blankMask, timeNeons(time % 60));
+  armFrame(frame);
+  armedTime = time;
 }
 
 /**
- * Function necessary for longevity of NIXIE tubes, it lights up every digit one after another and repeats it for a certain ammount of time
- * This should be done as frequently as possible, but every 15 minutes will be ok
- * @param timeInterval how long will cathode routine run (in milliseconds)
- * @param digitDelay time between digit changes (in milliseconds) make sure digitDelay is large relative to timeInterval because cathode routine will run longer
- * than digitDelay
+ * Plays selected digit transition from the previous second to the given time
+ * @param hours hour value to be displayed
+ * @param minutes minute value to be displayed
+ * @param seconds second value to be displayed
  */
-void doCathodeRoutine(const unsigned long timeInterval, const unsigned long digitDelay)
+void showTimeWithTransition(int hours, int minutes, int seconds)
 {
-  unsigned long previousTime = millis();
+  long previous = (hours * 3600L + minutes * 60 + seconds + seconds_per_day - 1) % seconds_per_day;
+  byte fromDigits[tube_count];
+  byte toDigits[tube_count];
+  byte fromBlank = timeDigits(fromDigits, previous / 3600, previous / 60 % 60, previous % 60);
+  byte toBlank = timeDigits(toDigits, hours, minutes, seconds);
 
-  while ((millis() - previousTime) <= timeInterval)
-  {
-    for (int i = 0; i < 10; i++) // loop runs 10 times since every NIXIE tube has 10 digits (0...9)
-    {
-      digitalWrite(latchPin, LOW);
-      shiftOutBits(dataPin, clockPin, LSBFIRST, i, 10, false);
-      shiftOutBits(dataPin, clockPin, LSBFIRST, i, 10, false);
-      shiftOutBits(dataPin, clockPin, LSBFIRST, i, 10, false);
-      shiftOutBits(dataPin, clockPin, LSBFIRST, i, 10, false);
-      digitalWrite(latchPin, HIGH);
-      delay(digitDelay);
-    }
-    for (int i = 8; i > 0; i--) // loop runs 10 times since every NIXIE tube has 10 digits (9...0)
-    {
-      digitalWrite(latchPin, LOW);
-      shiftOutBits(dataPin, clockPin, LSBFIRST, i, 10, false);
-      shiftOutBits(dataPin, clockPin, LSBFIRST, i, 10, false);
-      shiftOutBits(dataPin, clockPin, LSBFIRST, i, 10, false);
-      shiftOutBits(dataPin, clockPin, LSBFIRST, i, 10, false);
-      digitalWrite(latchPin, HIGH);
-      delay(digitDelay);
-    }
-  }
-  debugln("cathode routine has completed");
+  startTransition(fromDigits, fromBlank, timeNeons(previous % 60), toDigits, toBlank, timeNeons(seconds));
 }
 
-// function that calculates current minutes, hours, seconds and their respective digits
+// function that gets current minutes, hours and seconds from local clock (RTC module is only read when it needs resync)
 void getCurrentTime()
 {
-  DateTime now = rtc.now();
-
-  // store values of hours and minutes in their respecitive varables
-  hour = now.hour();
-  minute = now.minute();
+  int currentSecond;
 
-  // calculate hour and minute digit values
-  calculateTime();
+  getLocalTime(hour, minute, currentSecond);
 
-  // print out time from rtc module on seral monitor
-  if (second != now.second() && DEBUG == 1)
-  {
-    char buffer[10];
-    sprintf(buffer, "%02d:%02d:%02d", now.hour(), now.minute(), now.second());
-    debugln(buffer);
-    second = now.second();
-  }
+  // log time on every second
+  if (second != currentSecond)
+    log_debug("%02d:%02d:%02d", hour, minute, currentSecond);
+  second = currentSecond;
 }
 
 /**
  * Function that detects motion and turns on or off nixie display after some time of inactivity
+ * (timeout is shorter at rarely occupied times and display is lit ahead of habitually occupied ones, see occupancy.h)
  * @param timeDelay after how many minutes of inactivity will nixie display turn off
  */
 void motionDetection(const unsigned long timeDelay)
 {
-  int trigger = digitalRead(sensorPin);
+  bool trigger = Board::Sensor::read();
+  unsigned long timeout = timeDelay;
 
-  if (trigger == HIGH)
+  occupancyUpdate(getLocalWeekday(), hour, minute, trigger);
+
+  if (trigger)
   {
     previousTime = millis();
-    digitalWrite(displayControlPin, HIGH);
-    debugln("Motion has been detected!");
+    prelit = false;
+    if (!displayIsOn())
+      log_info("Motion has been detected!");
+    turnDisplayOn();
   }
+#if PREDICTIVE_DISPLAY == 1
+  else if (occupancyPrelight() && !displayIsOn())
+  {
+    previousTime = millis();
+    prelit = true;
+    log_info("Display is lit ahead of a habitually occupied time");
+    turnDisplayOn();
+  }
+  timeout = prelit ? occupancyShortTimeout(timeDelay) : occupancyTimeout(timeDelay);
+#endif
 
-  if (millis() - previousTime >= (timeDelay * 60000))
+  if (millis() - previousTime >= (timeout * 60000))
   {
-    digitalWrite(displayControlPin, LOW);
+    turnDisplayOff();
     previousTime = millis();
-    debug(timeDelay);
-    debugln(" minutes have passed and no motion has beed detected");
+    prelit = false;
+    log_info("%u minutes have passed and no motion has been detected", timeout);
   }
 }
 
-// menu page for changing hours
-void firstMenuPage()
+/**
+ * Shows the time that is being adjusted in setup mode
+ * @param blankMask digits that are blanked because they blink
+ */
+void showAdjustedTime(byte blankMask)
 {
-  while (setupMode == 1)
-  {
-    digitalWrite(hourLed, HIGH);
-    if (hour < 10) // blank first minute digit when time is 04:00 --> 4:00
-      updateDisplayedTime(hour_1);
-    else
-      updateDisplayedTime(false);
-    if (debouncedButtonRead(0, 50))
-      setupMode++;
-    if (debouncedButtonRead(1, 50))
-      hour = (hour + 1) % 24;
-    if (debouncedButtonRead(2, 50))
-    {
-      if (hour > 0)
-        hour--;
-      else if (hour == 0)
-        hour = 23;
-    }
-    calculateTime();
-    debug("Set hours : ");
-    debugln(hour);
-    digitalWrite(hourLed, LOW);
-  }
+  byte digits[tube_count];
+
+  blankMask |= timeDigits(digits, adjustedHour, adjustedMinute, 0);
+  displayDigits(digits, blankMask, timeNeons(0));
 }
 
-// menu page for changing minutes
-void secondMenuPage()
+// sets adjusted time in the RTC module when the last menu page is left
+void finishSetupMode()
 {
-  while (setupMode == 2)
-  {
-    digitalWrite(minuteLed, HIGH);
-    if (hour < 10) // blank first minute digit when time is 04:00 --> 4:00
-      updateDisplayedTime(hour_1);
-    else
-      updateDisplayedTime(false);
-    if (debouncedButtonRead(0, 50))
-      setupMode++;
-    if (debouncedButtonRead(1, 50))
-      minute = (minute + 1) % 60;
-    if (debouncedButtonRead(2, 50))
-    {
-      if (minute > 0)
-        minute--;
-      else if (minute == 0)
-        minute = 59;
-    }
-    calculateTime();
-    debug("Set minutes : ");
-    debugln(minute);
-    digitalWrite(minuteLed, LOW);
-  }
+  setRtcTime(adjustedHour, adjustedMinute, 0);
+  hour = adjustedHour;
+  minute = adjustedMinute;
+  requestTimeRefresh(); // make sure adjusted time gets displayed
 }
 
-// last menu page that sets adjusted time in the RTC module
-void lastMenuPage()
+// pages of setup mode, button 0 goes to the next page, 1 and 2 change the value up and down, the edited
+// digits blink with their LED
+const MenuPage setup_pages[] = {
+    {&adjustedHour, 0, 23, hour_1 | hour_2, MENU_HOUR_LED, showAdjustedTime},
+    {&adjustedMinute, 0, 59, minute_1 | minute_2, MENU_MINUTE_LED, showAdjustedTime},
+};
+
+// enters setup mode, time that is currently displayed is the starting point for adjusting
+void enterSetupMode()
 {
-  rtc.adjust(DateTime(rtc.now().year(), rtc.now().month(), rtc.now().day(), hour, minute, 0));
-  setupMode = 0;
+  stopCathodeRoutine();
+  stopTransition();
+  adjustedHour = hour;
+  adjustedMinute = minute;
+  menuEnter(setup_pages, sizeof(setup_pages) / sizeof(setup_pages[0]), finishSetupMode);
 }
 
 /**
  * check if minute value has changed, and if it did, update displayed time
- * @param timeToPass cathodeRoutine will run every timeToPass (in minutes)
+ * @param timeToPass adaptive cathodeRoutine will run every timeToPass (in minutes)
  */
 void timeChange(int timeToPass)
 {
+  if (timeRefreshRequested())
+    minuteChange = 100; // time was set, it is displayed even if the minute is the same
+
   if (minuteChange != minute)
   {
-    if (hour < 10) // blank first minute digit when time is 04:00 --> 4:00
-      updateDisplayedTime(hour_1);
-    else
-      updateDisplayedTime(false);
+    bool minuteRolledOver = minuteChange != 100; // 100 means display refresh after startup or time adjustment
+
     minuteChange = minute;
     minuteCounter++;
 
-    // check if half an hour has passed and do CathodeRoutine
-    if (minuteCounter == timeToPass)
-    {
-      debug(timeToPass);
-      debugln(" minutes have passed, doing cathodeRoutine...");
-      doCathodeRoutine(3000, 25);
-      if (hour < 10) // blank first minute digit when time is 04:00 --> 4:00
-        updateDisplayedTime(hour_1);
-      else
-        updateDisplayedTime(false);
+    // check if enough time has passed and start CathodeRoutine, time is displayed again when it completes
+    // (there is no point in doing it while the display is off, it would only keep the MCU awake)
+    bool routineDue = minuteCounter >= timeToPass;
+
+    if (routineDue)
       minuteCounter = 0;
+
+    if (routineDue && displayIsOn())
+    {
+      log_info("%u minutes have passed, doing cathode routine...", timeToPass);
+      stopTransition();
+      startAdaptiveCathodeRoutine(settings.routineLength, settings.routineDigitDelay);
     }
+    else if (!cathodeRoutineRunning())
+    {
+      if (minuteRolledOver && transitionMode() != TRANSITION_NONE && displayIsOn())
+        showTimeWithTransition(hour, minute, second);
+      else if (showTime(hour, minute, second) && minuteRolledOver && squareWaveActive())
+        recordEdgeLatency(); // time wasn't armed, it is latched this late after the second edge
+    }
+    secondChange = second;
   }
+  else if (second_updates && secondChange != second && !cathodeRoutineRunning() && !transitionRunning())
+  {
+    if (showTime(hour, minute, second) && squareWaveActive())
+      recordEdgeLatency(); // second wasn't armed
+    secondChange = second;
+  }
+
+  // frame of the next second (only the next minute if the display doesn't change every second) waits in the
+  // shift registers and gets latched on the next second edge, minutes aren't armed when they start with a transition
+  long nextTime = (hour * 3600L + minute * 60 + second + 1) % seconds_per_day;
+  bool armNext = second == 59 ? transitionMode() == TRANSITION_NONE : second_updates;
+
+  if (armNext && nextTime != armedTime && squareWaveActive() && !cathodeRoutineRunning() && !transitionRunning())
+    armTime(nextTime);
 }
 
 void setup()
 {
+  // settings are loaded from EEPROM once, everything below is configured from them
+  settingsBegin();
+
   // wait for rtc module to connect
-  while (!rtc.begin())
+  while (!ds3231Begin())
     continue;
+  timekeeperBegin(settings.resyncInterval * 60000UL);
+
+  buttonsBegin(settings.buttonSampleTicks);
+
+  Board::Latch::output();
+  Board::Clock::output();
+  Board::Data::output();
+  Board::MasterReset::output();
+  Board::HourLed::output();
+  Board::MinuteLed::output();
+  Board::Sensor::input();
+  powerBegin();
+  brightnessBegin(settings.brightness); // display stays off until the startup cathode routine is done
+  wearBegin();
+  occupancyBegin();
+
+  Board::MasterReset::low();
+  delayMicroseconds(10);
+  Board::MasterReset::high();
+  shiftRegisterBegin();
 
-  for (int i = 0; i < number_of_buttons; i++)
-    pinMode(button[i], INPUT_PULLUP);
+  // startup cathode routine runs to the end before the display is turned on
+  startCathodeRoutine(2000, settings.routineDigitDelay);
+  while (cathodeRoutineStep())
+    continue;
 
-  pinMode(latchPin, OUTPUT);
-  pinMode(clockPin, OUTPUT);
-  pinMode(dataPin, OUTPUT);
-  pinMode(masterReset, OUTPUT);
-  pinMode(hourLed, OUTPUT);
-  pinMode(minuteLed, OUTPUT);
-  pinMode(displayControlPin, OUTPUT);
-  pinMode(sensorPin, INPUT);
+  // buttons are sampled, display is faded in and digit transitions are played from system tick
+  setTransitionMode((TransitionMode)settings.transition);
+  tickBegin();
+  turnDisplayOn();
 
-  digitalWrite(masterReset, LOW);
-  delayMicroseconds(10);
-  digitalWrite(masterReset, HIGH);
-  doCathodeRoutine(2000, 25);
-  digitalWrite(displayControlPin, HIGH);
+  // serial communication for host commands and debugging
+  protocolBegin();
+  reportShiftBackendTiming();
 
-  // serial communication for debugging
-  debug_begin(9600);
+  // timer and serial communication for profiling
+  profile_begin();
 }
 
 void loop()
 {
+  profile_start(STAGE_LOOP);
+
   // get current time
+  profile_start(STAGE_GET_TIME);
   getCurrentTime();
-  // check for time change
-  timeChange(15);
+  profile_stop(STAGE_GET_TIME);
+
   // check for motion
-  motionDetection(60);
-  // check for menu button press
-  if (debouncedButtonRead(0, 50))
-    setupMode++;
+  profile_start(STAGE_MOTION);
+  motionDetection(settings.motionTimeout);
+  profile_stop(STAGE_MOTION);
 
-  switch (setupMode)
+  if (menuActive())
+  {
+    // setup mode, display and LEDs are only redrawn when something changed
+    profile_start(STAGE_MENU);
+    menuPoll();
+    profile_stop(STAGE_MENU);
+  }
+  else
   {
-  case 1:
-    firstMenuPage();
-  case 2:
-    secondMenuPage();
-  case 3:
-    lastMenuPage();
-    break;
+    // check for time change
+    profile_start(STAGE_TIME_CHANGE);
+    timeChange(settings.cathodeInterval);
+    // show the next digit of cathode routine, when it is done show time again
+    if (cathodeRoutineRunning() && !cathodeRoutineStep())
+      showTime(hour, minute, second);
+    // shift out the next step of a digit transition, the system tick latches it when it is due
+    transitionPoll();
+    profile_stop(STAGE_TIME_CHANGE);
+
+    // check for menu button press
+    profile_start(STAGE_BUTTONS);
+    if (buttonPressed(0))
+    {
+      enterSetupMode();
+      menuPoll(); // first page is shown right away
+    }
+    profile_stop(STAGE_BUTTONS);
   }
-}
\ No newline at end of file
+
+  profile_stop(STAGE_LOOP);
+
+  // save settings, cathode wear statistics and learned occupancy (one byte at a time, statistics only once per hour)
+  settingsSaveStep();
+  wearSaveStep();
+  occupancySaveStep();
+
+  // execute commands from host or serial monitor
+  protocolPoll(menuActive());
+
+  // write logged messages to serial monitor
+  logFlush();
+
+  // sleep until motion, button press or the next second when the display is off
+  if (!menuActive())
+    sleepWhenIdle();
+}
@@ -0,0 +1,109 @@
+#include <Arduino.h>
+#include "blink.h"
+#include "buttons.h"
+#include "log.h"
+#include "menu.h"
+#include "pins.h"
+
+const byte next_button = 0x01;
+const byte up_button = 0x02;
+const byte down_button = 0x04;
+
+static const MenuPage *menuPages = nullptr;
+static byte pageCount = 0;
+static byte currentPage = 0;
+static void (*finishMenu)() = nullptr;
+static bool active = false;
+static bool redraw = false;
+
+// lights the indicator LEDs of a page, the others are turned off
+static void showLeds(byte leds)
+{
+  if (leds & MENU_HOUR_LED)
+    Board::HourLed::high();
+  else
+    Board::HourLed::low();
+  if (leds & MENU_MINUTE_LED)
+    Board::MinuteLed::high();
+  else
+    Board::MinuteLed::low();
+}
+
+// starts blinking what belongs to the current page
+static void startPage()
+{
+  const MenuPage &page = menuPages[currentPage];
+
+  blinkStart(page.tubes, page.leds);
+  redraw = true;
+}
+
+void menuEnter(const MenuPage *pages, byte count, void (*finish)())
+{
+  menuPages = pages;
+  pageCount = count;
+  currentPage = 0;
+  finishMenu = finish;
+  active = true;
+  startPage();
+  buttonPresses(); // presses that came before the menu was opened aren't meant for it
+}
+
+bool menuActive()
+{
+  return active;
+}
+
+void menuRedraw()
+{
+  redraw = true;
+}
+
+void menuPoll()
+{
+  if (!active)
+    return;
+
+  byte presses = buttonPresses();
+
+  if (blinkPhaseChanged())
+    redraw = true;
+  if (!presses && !redraw)
+    return;
+
+  const MenuPage &page = menuPages[currentPage];
+  int value = *page.value;
+
+  if (presses & up_button)
+    value = value < page.maximum ? value + 1 : page.minimum;
+  if (presses & down_button)
+    value = value > page.minimum ? value - 1 : page.maximum;
+  if (value != *page.value)
+  {
+    *page.value = value;
+    blinkRestart();
+    redraw = true;
+    log_debug("Menu page %d: %d", currentPage, value);
+  }
+
+  if (presses & next_button)
+  {
+    if (++currentPage == pageCount)
+    {
+      active = false;
+      blinkStop();
+      showLeds(0);
+      finishMenu();
+      return;
+    }
+    startPage();
+  }
+
+  if (redraw)
+  {
+    // the phase may have changed since it was checked, it is redrawn again on the next call then
+    redraw = false;
+    showLeds(blinkLeds());
+    menuPages[currentPage].show(blinkBlankMask());
+  }
+}
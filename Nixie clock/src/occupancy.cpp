@@ -0,0 +1,162 @@
+#include <Arduino.h>
+#include <avr/eeprom.h>
+#include "eeprom_layout.h"
+#include "occupancy.h"
+#include "timekeeper.h"
+
+const uint32_t occupancy_magic = 0x4F430000UL | occupancy_slot_minutes; // "OC" and slot length
+const byte score_max = 15;
+const byte score_start = 6;
+const int score_bytes = occupancy_slots / 2;
+
+static byte scores[score_bytes]; // slot 2n in the low nibble of byte n, slot 2n + 1 in the high one
+static int currentSlot = -1;     // -1 until the first update
+static byte slotMinute = 0;      // minutes since the current slot started
+static bool motionInSlot = false;
+static int prelitSlot = -1; // slot that the display was last lit ahead of
+
+// saving state
+static unsigned long lastSave = 0; // elapsedSeconds() at the last save
+static int saveIndex = -1; // byte being saved, -1 when not saving
+
+static byte score(int slot)
+{
+  byte value = scores[slot / 2];
+
+  return slot % 2 ? value >> 4 : value & 0x0F;
+}
+
+static void setScore(int slot, byte value)
+{
+  byte &pair = scores[slot / 2];
+
+  pair = slot % 2 ? (pair & 0x0F) | value << 4 : (pair & 0xF0) | value;
+}
+
+static int nextSlot(int slot)
+{
+  return (slot + 1) % occupancy_slots;
+}
+
+// slot of a time, the week starts on Monday at midnight
+static int slotOf(byte weekday, int hours, int minutes)
+{
+  return ((weekday - 1) * 24 * 60 + hours * 60 + minutes) / occupancy_slot_minutes;
+}
+
+/*
+moves score a quarter of the way towards 15 or 0, rounded away from the old score so the ends are reached
+(0 > 4 > 7 > 9 > 11 > 12 ... with motion, 15 > 11 > 8 > 6 > 4 > 3 > 2 ... without)
+*/
+static void scoreSlot(int slot, bool occupied)
+{
+  byte value = score(slot);
+
+  if (occupied)
+    value += (score_max - value + 3) / 4;
+  else
+    value -= (value + 3) / 4;
+  setScore(slot, value);
+}
+
+void occupancyBegin()
+{
+  uint32_t magic;
+
+  eeprom_read_block(&magic, (const void *)occupancy_address, sizeof(magic));
+  if (magic == occupancy_magic)
+    eeprom_read_block(scores, (const void *)(occupancy_address + sizeof(magic)), sizeof(scores));
+  else
+  {
+    memset(scores, score_start | score_start << 4, sizeof(scores));
+    eeprom_update_block(&occupancy_magic, (void *)occupancy_address, sizeof(occupancy_magic));
+  }
+  lastSave = elapsedSeconds();
+}
+
+void occupancyUpdate(byte weekday, int hours, int minutes, bool motion)
+{
+  int slot = slotOf(weekday, hours, minutes);
+
+  // a slot is only scored when time moved on into the next one, not when time was set
+  if (slot != currentSlot)
+  {
+    if (currentSlot >= 0 && slot == nextSlot(currentSlot))
+      scoreSlot(currentSlot, motionInSlot);
+    currentSlot = slot;
+    motionInSlot = false;
+  }
+  slotMinute = minutes % occupancy_slot_minutes;
+  motionInSlot |= motion;
+}
+
+unsigned long occupancyShortTimeout(unsigned long timeout)
+{
+  return min(timeout, max(timeout / 4, (unsigned long)occupancy_min_timeout));
+}
+
+unsigned long occupancyTimeout(unsigned long timeout)
+{
+  if (currentSlot < 0 || max(score(currentSlot), score(nextSlot(currentSlot))) >= occupancy_rare)
+    return timeout;
+  return occupancyShortTimeout(timeout);
+}
+
+bool occupancyPrelight()
+{
+  if (currentSlot < 0 || slotMinute < occupancy_slot_minutes - occupancy_prelight)
+    return false;
+
+  int slot = nextSlot(currentSlot);
+
+  if (slot == prelitSlot || score(slot) < occupancy_habitual)
+    return false;
+  prelitSlot = slot;
+  return true;
+}
+
+byte occupancyScore(byte weekday, int hours, int minutes)
+{
+  return score(slotOf(weekday, hours, minutes));
+}
+
+void occupancySaveStep()
+{
+  if (saveIndex < 0)
+  {
+    if (!intervalPassed(lastSave, eeprom_save_interval))
+      return;
+    saveIndex = 0;
+  }
+
+  if (!eeprom_is_ready())
+    return;
+
+  eeprom_update_byte((uint8_t *)(occupancy_address + sizeof(occupancy_magic) + saveIndex), scores[saveIndex]);
+  if (++saveIndex == score_bytes)
+    saveIndex = -1;
+}
+
+bool occupancySaving()
+{
+  return saveIndex >= 0;
+}
+
+void printOccupancy()
+{
+  static const char days[7][4] = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
+  const int slots_per_day = occupancy_slots / 7;
+
+  Serial.println(F("occupancy score (0...F) of every 15 minutes, one day per line starting at midnight"));
+  for (int day = 0; day < 7; day++)
+  {
+    Serial.print(days[day]);
+    for (int i = 0; i < slots_per_day; i++)
+    {
+      if (i % 4 == 0)
+        Serial.print(' ');
+      Serial.print(score(day * slots_per_day + i), HEX);
+    }
+    Serial.println();
+  }
+}
@@ -0,0 +1,95 @@
+#include <Arduino.h>
+#include <avr/eeprom.h>
+#include <avr/sleep.h>
+#include "brightness.h"
+#include "buttons.h"
+#include "calibration.h"
+#include "cathode_routine.h"
+#include "log.h"
+#include "occupancy.h"
+#include "pins.h"
+#include "power.h"
+#include "protocol.h"
+#include "settings.h"
+#include "timekeeper.h"
+#include "transitions.h"
+#include "wear.h"
+
+unsigned long sleepCount = 0;
+
+// pin change interrupts only wake the MCU up, pins are read in the loop (PCINT2_vect is in calibration.cpp)
+EMPTY_INTERRUPT(PCINT0_vect);
+
+#if LOW_POWER == 1
+/*
+returns true if nothing else than waiting for motion is going on; a pressed button keeps the MCU awake, Timer0
+doesn't run in sleep, so buttons are only debounced (and presses seen) while it is awake
+*/
+static bool idle()
+{
+  return !displayIsOn() && !displayIsLit() && !cathodeRoutineRunning() && !transitionRunning() &&
+         !settingsSaving() && !wearSaving() && !occupancySaving() && eeprom_is_ready() && squareWaveActive() &&
+         protocolIdle() && logIdle() && !calibrationActive() && !buttonsBusy();
+}
+
+// enables or disables pin change interrupts of the pins that wake the MCU up
+static void setWakeInterrupts(bool enable)
+{
+  if (enable)
+  {
+    Board::SerialRx::enablePinChange();
+    Board::Sensor::enablePinChange();
+    Board::Button0::enablePinChange();
+    Board::Button1::enablePinChange();
+    Board::Button2::enablePinChange();
+  }
+  else
+  {
+    Board::SerialRx::disablePinChange();
+    Board::Sensor::disablePinChange();
+    Board::Button0::disablePinChange();
+    Board::Button1::disablePinChange();
+    Board::Button2::disablePinChange();
+  }
+}
+#endif
+
+void powerBegin()
+{
+  ADCSRA &= ~_BV(ADEN); // analog inputs aren't used
+}
+
+void sleepWhenIdle()
+{
+#if LOW_POWER == 1
+  if (!idle())
+    return;
+
+  // wake up on serial data, PIR sensor and buttons, square wave interrupt is always enabled
+  setWakeInterrupts(true);
+
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  cli();
+  sleep_enable();
+  sleep_bod_disable();
+  sei();
+  sleep_cpu();
+  sleep_disable();
+  sleepCount++;
+
+  setWakeInterrupts(false);
+#endif
+}
+
+unsigned long secondsAwake()
+{
+  return millis() / 1000;
+}
+
+unsigned long secondsAsleep()
+{
+  unsigned long uptime = squareWaveTicks();
+  unsigned long awake = secondsAwake();
+
+  return uptime > awake ? uptime - awake : 0;
+}
@@ -0,0 +1,114 @@
+#include <Arduino.h>
+#include "profiler.h"
+
+#if PROFILING == 1
+
+const int histogram_bins = 16;
+
+struct StageStatistics
+{
+  unsigned long start;                // Timer1 ticks when the stage was started
+  unsigned long minimum;              // in microseconds
+  unsigned long maximum;              // in microseconds
+  unsigned long total;                // in microseconds, used for mean
+  unsigned long count;                // number of measurements
+  unsigned int histogram[histogram_bins];
+};
+
+static StageStatistics stages[STAGE_COUNT];
+static volatile unsigned int timerOverflows = 0; // upper 16 bits of Timer1 ticks
+
+static const char stageNames[STAGE_COUNT][12] PROGMEM = {
+    "loop", "getTime", "timeChange", "motion", "buttons", "menu"};
+
+ISR(TIMER1_OVF_vect)
+{
+  timerOverflows++;
+}
+
+// returns Timer1 ticks extended to 32 bits (one tick is 0.5us)
+static unsigned long profilerTicks()
+{
+  byte oldSREG = SREG;
+  cli();
+  unsigned int low = TCNT1;
+  unsigned int high = timerOverflows;
+
+  // overflow happened, but its interrupt hasn't run yet
+  if ((TIFR1 & _BV(TOV1)) && low < 0x8000)
+    high++;
+  SREG = oldSREG;
+
+  return ((unsigned long)high << 16) | low;
+}
+
+void profilerBegin()
+{
+  // Timer1 in normal mode, prescaler 8 -> 2MHz at 16MHz clock
+  TCCR1A = 0;
+  TCCR1B = _BV(CS11);
+  TCNT1 = 0;
+  TIMSK1 = _BV(TOIE1);
+
+  resetProfile();
+}
+
+void profileStart(ProfileStage stage)
+{
+  stages[stage].start = profilerTicks();
+}
+
+void profileStop(ProfileStage stage)
+{
+  StageStatistics &s = stages[stage];
+  unsigned long time = (profilerTicks() - s.start) / 2;
+
+  if (time < s.minimum)
+    s.minimum = time;
+  if (time > s.maximum)
+    s.maximum = time;
+  s.total += time;
+  s.count++;
+
+  // bin is the number of bits needed for the time
+  int bin = 0;
+  for (unsigned long t = time; t != 0 && bin < histogram_bins - 1; t >>= 1)
+    bin++;
+  if (s.histogram[bin] != 0xFFFF)
+    s.histogram[bin]++;
+}
+
+void printProfile()
+{
+  Serial.println(F("stage min max mean count | histogram (<1us, <2us, <4us ...)"));
+  for (int i = 0; i < STAGE_COUNT; i++)
+  {
+    const StageStatistics &s = stages[i];
+
+    Serial.print((const __FlashStringHelper *)stageNames[i]);
+    Serial.print(' ');
+    Serial.print(s.count ? s.minimum : 0);
+    Serial.print(' ');
+    Serial.print(s.maximum);
+    Serial.print(' ');
+    Serial.print(s.count ? s.total / s.count : 0);
+    Serial.print(' ');
+    Serial.print(s.count);
+    Serial.print(F(" |"));
+    for (int j = 0; j < histogram_bins; j++)
+    {
+      Serial.print(' ');
+      Serial.print(s.histogram[j]);
+    }
+    Serial.println();
+  }
+}
+
+void resetProfile()
+{
+  memset(stages, 0, sizeof(stages));
+  for (int i = 0; i < STAGE_COUNT; i++)
+    stages[i].minimum = 0xFFFFFFFF;
+}
+
+#endif
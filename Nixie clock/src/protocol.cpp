@@ -0,0 +1,329 @@
+#include <Arduino.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
+#include "brightness.h"
+#include "buttons.h"
+#include "calibration.h"
+#include "cathode_routine.h"
+#include "console.h"
+#include "debug.h"
+#include "display.h"
+#include "ds3231.h"
+#include "power.h"
+#include "protocol.h"
+#include "settings.h"
+#include "timekeeper.h"
+#include "transitions.h"
+#include "wear.h"
+
+const byte protocol_version = 2;
+const byte bytes_per_poll = 16;              // at most this many bytes are parsed per loop
+const unsigned long frame_timeout = 100;     // unfinished frame is dropped after this time (in milliseconds)
+
+enum ParserState
+{
+  WAIT_SYNC,
+  WAIT_LENGTH,
+  WAIT_COMMAND,
+  WAIT_PAYLOAD,
+  WAIT_CRC_LOW,
+  WAIT_CRC_HIGH
+};
+
+static ParserState state = WAIT_SYNC;
+static byte length = 0;
+static byte command = 0;
+static byte payload[protocol_max_payload];
+static byte received = 0;      // payload bytes received so far
+static unsigned int crc = 0;
+static byte crcLow = 0;
+static unsigned long frameStart = 0;
+static unsigned long lastByte = 0;  // time the last byte was parsed
+static bool resyncing = false;      // a frame ended, following bytes may be its tail until the line goes idle
+
+// answer that is being put together
+static byte answer[protocol_max_payload];
+static byte answerLength = 0;
+
+static void addToAnswer(const void *data, byte size)
+{
+  memcpy(answer + answerLength, data, size);
+  answerLength += size;
+}
+
+// values are always sent as 4 bytes
+static void addLongToAnswer(uint32_t value)
+{
+  addToAnswer(&value, sizeof(value));
+}
+
+// sends the answer frame, it is short enough to fit into the serial transmit buffer
+static void sendAnswer(byte status)
+{
+  unsigned int answerCrc = 0xFFFF;
+  byte header[3] = {protocol_sync, (byte)(answerLength + 1), (byte)(command | 0x80)};
+
+  answerCrc = _crc_ccitt_update(answerCrc, header[1]);
+  answerCrc = _crc_ccitt_update(answerCrc, header[2]);
+  answerCrc = _crc_ccitt_update(answerCrc, status);
+  for (byte i = 0; i < answerLength; i++)
+    answerCrc = _crc_ccitt_update(answerCrc, answer[i]);
+
+  Serial.write(header, sizeof(header));
+  Serial.write(status);
+  Serial.write(answer, answerLength);
+  Serial.write(lowByte(answerCrc));
+  Serial.write(highByte(answerCrc));
+}
+
+// applies settings that are not read again on every use
+static void applySettings()
+{
+  setBrightness(settings.brightness);
+  setTransitionMode((TransitionMode)settings.transition);
+  setResyncInterval(settings.resyncInterval * 60000UL);
+  setButtonSampleTicks(settings.buttonSampleTicks);
+}
+
+// checks that written settings make sense
+static bool validSettings(const Settings &s)
+{
+  return s.cathodeInterval != 0 && s.motionTimeout != 0 && s.routineDigitDelay != 0 && s.buttonSampleTicks != 0 &&
+         s.brightness != 0 && s.brightness < brightness_levels && s.transition <= TRANSITION_CASCADE && s.resyncInterval != 0;
+}
+
+// checks year, month, day, hour, minute and second of a time in a frame (the RTC only keeps 2000...2099)
+static bool validTime(const byte *time)
+{
+  unsigned int year = time[0] | time[1] << 8;
+
+  return year >= 2000 && year <= 2099 && time[2] >= 1 && time[2] <= 12 && time[3] >= 1 &&
+         time[3] <= daysInMonth(year, time[2]) && time[4] <= 23 && time[5] <= 59 && time[6] <= 59;
+}
+
+// executes a received frame and answers it
+static void executeFrame(bool menuActive)
+{
+  byte status = STATUS_OK;
+
+  answerLength = 0;
+  switch (command)
+  {
+  case COMMAND_PING:
+    addToAnswer(&protocol_version, 1);
+    break;
+
+  case COMMAND_SET_TIME:
+    if (length != 7)
+      status = STATUS_BAD_LENGTH;
+    else if (menuActive)
+      status = STATUS_BUSY;
+    else if (!validTime(payload))
+      status = STATUS_BAD_VALUE;
+    else
+    {
+      setRtcDateTime(payload[0] | payload[1] << 8, payload[2], payload[3], payload[4], payload[5], payload[6]);
+      requestTimeRefresh(); // new time is displayed right away, not only when the minute changes
+    }
+    break;
+
+  case COMMAND_READ_CONFIG:
+    addToAnswer(&settings, sizeof(settings));
+    break;
+
+  case COMMAND_WRITE_CONFIG:
+    if (length != sizeof(Settings))
+      status = STATUS_BAD_LENGTH;
+    else if (!validSettings(*(const Settings *)payload))
+      status = STATUS_BAD_VALUE;
+    else
+    {
+      memcpy(&settings, payload, sizeof(Settings));
+      applySettings();
+      saveSettings();
+    }
+    break;
+
+  case COMMAND_READ_STATS:
+  {
+    unsigned long latency, latched, skipped;
+
+    // these are updated from interrupts as well
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+      latency = maxEdgeLatency;
+      latched = framesLatched;
+      skipped = framesSkipped;
+    }
+    addLongToAnswer(rtcReadsPerHour);
+    addLongToAnswer(timeRequestsPerHour);
+    addLongToAnswer(latency);
+    addLongToAnswer(latched);
+    addLongToAnswer(skipped);
+    addLongToAnswer(sleepCount);
+    addLongToAnswer(secondsAwake());
+    addLongToAnswer(secondsAsleep());
+    break;
+  }
+
+  case COMMAND_READ_WEAR:
+    if (length != 1)
+      status = STATUS_BAD_LENGTH;
+    else if (payload[0] >= tube_count)
+      status = STATUS_BAD_VALUE;
+    else
+    {
+      addToAnswer(payload, 1);
+      for (int i = 0; i < 10; i++)
+        addLongToAnswer(cathodeUsage(payload[0], i));
+    }
+    break;
+
+  case COMMAND_RUN_ROUTINE:
+    if (menuActive || cathodeRoutineRunning())
+      status = STATUS_BUSY;
+    else
+    {
+      stopTransition();
+      startAdaptiveCathodeRoutine(settings.routineLength, settings.routineDigitDelay);
+    }
+    break;
+
+  case COMMAND_CALIBRATION_MARK:
+  {
+    CalibrationMark mark;
+    uint32_t reference;
+
+    memcpy(&reference, payload, sizeof(reference));
+    if (length != sizeof(reference))
+      status = STATUS_BAD_LENGTH;
+    else if (!calibrationMark(reference, mark))
+      status = STATUS_BUSY; // start bit wasn't taken, the host repeats the mark
+    else
+      addToAnswer(&mark, sizeof(mark));
+    break;
+  }
+
+  case COMMAND_AGING_OFFSET:
+  {
+    if (length > 1)
+      status = STATUS_BAD_LENGTH;
+    else if (length == 1)
+      ds3231WriteAgingOffset((int8_t)payload[0]);
+
+    int8_t offset = ds3231ReadAgingOffset();
+    addToAnswer(&offset, 1);
+    break;
+  }
+
+  case COMMAND_SET_TIME_ALIGNED:
+  {
+    uint32_t delay;
+    RtcTime time = {payload[0] | payload[1] << 8, payload[2], payload[3], payload[4], payload[5], payload[6]};
+
+    memcpy(&delay, payload + 7, sizeof(delay));
+    if (length != 11)
+      status = STATUS_BAD_LENGTH;
+    else if (menuActive)
+      status = STATUS_BUSY;
+    else if (!validTime(payload) || delay > max_set_delay)
+      status = STATUS_BAD_VALUE;
+    else if (!setRtcTimeAligned(time, delay))
+      status = STATUS_BUSY; // start bit wasn't taken or the delay has passed already
+    else
+      requestTimeRefresh();
+    break;
+  }
+
+  default:
+    status = STATUS_UNKNOWN_COMMAND;
+  }
+
+  sendAnswer(status);
+
+  // the start bit of the next frame is timed while calibration marks keep coming
+  if (command == COMMAND_CALIBRATION_MARK || calibrationActive())
+    calibrationArm();
+}
+
+void protocolBegin()
+{
+  Serial.begin(serial_baud);
+}
+
+// frame was executed or dropped, bytes are looked for the next sync byte
+static void endFrame()
+{
+  state = WAIT_SYNC;
+  resyncing = true;
+}
+
+void protocolPoll(bool menuActive)
+{
+  if (state != WAIT_SYNC && millis() - frameStart > frame_timeout)
+    endFrame();
+  // rest of a dropped frame can't be mistaken for console commands once the line was idle
+  if (resyncing && millis() - lastByte > frame_timeout)
+    resyncing = false;
+
+  for (byte i = 0; i < bytes_per_poll && Serial.available() > 0; i++)
+  {
+    byte data = Serial.read();
+
+    lastByte = millis();
+    switch (state)
+    {
+    case WAIT_SYNC:
+      if (data == protocol_sync)
+      {
+        state = WAIT_LENGTH;
+        frameStart = millis();
+        crc = 0xFFFF;
+      }
+      else if (!resyncing)
+      {
+        console_command(data); // not a frame, might be a serial monitor command
+      }
+      break;
+
+    case WAIT_LENGTH:
+      length = data;
+      crc = _crc_ccitt_update(crc, data);
+      if (length <= protocol_max_payload)
+        state = WAIT_COMMAND;
+      else
+        endFrame();
+      break;
+
+    case WAIT_COMMAND:
+      command = data;
+      crc = _crc_ccitt_update(crc, data);
+      received = 0;
+      state = length ? WAIT_PAYLOAD : WAIT_CRC_LOW;
+      break;
+
+    case WAIT_PAYLOAD:
+      payload[received++] = data;
+      crc = _crc_ccitt_update(crc, data);
+      if (received == length)
+        state = WAIT_CRC_LOW;
+      break;
+
+    case WAIT_CRC_LOW:
+      crcLow = data;
+      state = WAIT_CRC_HIGH;
+      break;
+
+    case WAIT_CRC_HIGH:
+      endFrame();
+      if ((unsigned int)(crcLow | data << 8) == crc)
+        executeFrame(menuActive);
+      break;
+    }
+  }
+}
+
+bool protocolIdle()
+{
+  return state == WAIT_SYNC && Serial.available() == 0 && Serial.availableForWrite() >= SERIAL_TX_BUFFER_SIZE - 1;
+}
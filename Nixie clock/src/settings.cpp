@@ -0,0 +1,104 @@
+#include <Arduino.h>
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+#include "eeprom_layout.h"
+#include "settings.h"
+#include "transitions.h"
+
+struct __attribute__((packed)) SettingsRecord
+{
+  uint16_t sequence; // newer records have larger sequence numbers (with overflow)
+  Settings settings;
+  uint16_t crc;      // CRC of sequence and settings
+};
+
+const byte settings_version = 1; // change whenever Settings changes, so old records aren't loaded
+const int settings_slots = settings_size / sizeof(SettingsRecord);
+
+static const Settings defaultSettings = {
+    15,              // cathodeInterval
+    60,              // motionTimeout
+    1500,            // routineLength
+    25,              // routineDigitDelay
+    10,              // buttonSampleTicks
+    31,              // brightness
+    TRANSITION_NONE, // transition
+    10               // resyncInterval
+};
+
+Settings settings;
+
+static uint16_t lastSequence = 0;
+static int lastSlot = -1;     // slot of the newest record, -1 if there is none
+static SettingsRecord pending; // record that is being saved
+static int pendingSlot = -1;   // slot where the pending record is saved, -1 when not saving
+static byte pendingByte = 0;   // next byte of the pending record to be written
+
+// calculates CRC of the record without its crc field
+static uint16_t recordCrc(const SettingsRecord &record)
+{
+  const byte *data = (const byte *)&record;
+  uint16_t crc = _crc_ccitt_update(0xFFFF, settings_version);
+
+  for (size_t i = 0; i < offsetof(SettingsRecord, crc); i++)
+    crc = _crc_ccitt_update(crc, data[i]);
+  return crc;
+}
+
+// returns EEPROM address of a slot
+static byte *slotAddress(int slot)
+{
+  return (byte *)(settings_address + slot * sizeof(SettingsRecord));
+}
+
+void settingsBegin()
+{
+  SettingsRecord record;
+
+  for (int i = 0; i < settings_slots; i++)
+  {
+    eeprom_read_block(&record, slotAddress(i), sizeof(record));
+    if (record.crc != recordCrc(record))
+      continue;
+
+    // sequence numbers are compared with overflow, so the log can be written forever
+    if (lastSlot < 0 || (int16_t)(record.sequence - lastSequence) > 0)
+    {
+      lastSlot = i;
+      lastSequence = record.sequence;
+      settings = record.settings;
+    }
+  }
+
+  if (lastSlot < 0)
+    settings = defaultSettings;
+}
+
+void saveSettings()
+{
+  pending.sequence = lastSequence + 1;
+  pending.settings = settings;
+  pending.crc = recordCrc(pending);
+  pendingSlot = (lastSlot + 1) % settings_slots;
+  pendingByte = 0;
+}
+
+void settingsSaveStep()
+{
+  if (pendingSlot < 0 || !eeprom_is_ready())
+    return;
+
+  eeprom_update_byte(slotAddress(pendingSlot) + pendingByte, ((const byte *)&pending)[pendingByte]);
+
+  if (++pendingByte == sizeof(SettingsRecord))
+  {
+    lastSlot = pendingSlot;
+    lastSequence = pending.sequence;
+    pendingSlot = -1;
+  }
+}
+
+bool settingsSaving()
+{
+  return pendingSlot >= 0;
+}
@@ -0,0 +1,121 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include "log.h"
+#include "pins.h"
+#include "shift_register.h"
+
+unsigned long frameTransferTime = 0;
+
+// backends that aren't used are only built for the timing report of debug builds
+#define REPORT_TIMING (LOG_LEVEL >= LOG_LEVEL_DEBUG)
+
+#if SHIFT_BACKEND == SHIFT_BACKEND_DIGITAL || REPORT_TIMING
+// shifts out the frame one bit at a time with digitalWrite()
+static void shiftFrameDigital(const byte *frame)
+{
+  for (int i = 0; i < frame_bytes * 8; i++)
+  {
+    digitalWrite(Board::Data::number, (frame[i / 8] >> (i % 8)) & 1);
+    digitalWrite(Board::Clock::number, HIGH);
+    digitalWrite(Board::Clock::number, LOW);
+  }
+}
+#endif
+
+#if SHIFT_BACKEND == SHIFT_BACKEND_PORT || REPORT_TIMING
+// shifts out the frame one bit at a time by writing to the port register directly (every write is a single sbi/cbi)
+static void shiftFramePort(const byte *frame)
+{
+  for (int i = 0; i < frame_bytes; i++)
+  {
+    byte value = frame[i];
+    for (byte mask = 0x01; mask != 0; mask <<= 1)
+    {
+      Board::Data::write(value & mask);
+      Board::Clock::high();
+      Board::Clock::low();
+    }
+  }
+}
+#endif
+
+#if SHIFT_BACKEND == SHIFT_BACKEND_SPI || REPORT_TIMING
+// TPIC6B595 shifts on the rising edge of SRCK, so SPI mode 0 is used, 4MHz leaves margin for the 10MHz maximum
+static const SPISettings shiftSettings(4000000, LSBFIRST, SPI_MODE0);
+
+// shifts out the frame one byte at a time with hardware SPI, LSB first to keep the same bit order
+static void shiftFrameSpi(const byte *frame)
+{
+  SPI.beginTransaction(shiftSettings);
+  for (int i = 0; i < frame_bytes; i++)
+    SPI.transfer(frame[i]);
+  SPI.endTransaction();
+}
+#endif
+
+void shiftRegisterBegin()
+{
+#if SHIFT_BACKEND == SHIFT_BACKEND_SPI
+  SPI.begin(); // SS is pin 10 (Board::MasterReset), SPI.begin() leaves it as a HIGH output
+#endif
+}
+
+void shiftFrame(const byte *frame)
+{
+  unsigned long startTime = micros();
+
+#if SHIFT_BACKEND == SHIFT_BACKEND_DIGITAL
+  digitalWrite(Board::Latch::number, LOW);
+  shiftFrameDigital(frame);
+#else
+  Board::Latch::low();
+#if SHIFT_BACKEND == SHIFT_BACKEND_SPI
+  shiftFrameSpi(frame);
+#else
+  shiftFramePort(frame);
+#endif
+#endif
+
+  frameTransferTime = micros() - startTime;
+}
+
+void latchFrame()
+{
+#if SHIFT_BACKEND == SHIFT_BACKEND_DIGITAL
+  digitalWrite(Board::Latch::number, HIGH);
+#else
+  Board::Latch::high();
+#endif
+}
+
+void shiftOutFrame(const byte *frame)
+{
+  shiftFrame(frame);
+  latchFrame();
+}
+
+void reportShiftBackendTiming()
+{
+#if REPORT_TIMING
+  const byte blankFrame[frame_bytes] = {0};
+  unsigned long startTime;
+
+  startTime = micros();
+  shiftFrameDigital(blankFrame);
+  log_debug("digitalWrite backend frame time (us): %u", micros() - startTime);
+
+  startTime = micros();
+  shiftFramePort(blankFrame);
+  log_debug("port backend frame time (us): %u", micros() - startTime);
+
+#if SHIFT_BACKEND != SHIFT_BACKEND_SPI
+  SPI.begin();
+#endif
+  startTime = micros();
+  shiftFrameSpi(blankFrame);
+  log_debug("SPI backend frame time (us): %u", micros() - startTime);
+#if SHIFT_BACKEND != SHIFT_BACKEND_SPI
+  SPI.end(); // give data pin back to port writes
+#endif
+#endif
+}
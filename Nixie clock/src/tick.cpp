@@ -0,0 +1,38 @@
+#include <Arduino.h>
+#include <util/atomic.h>
+#include "blink.h"
+#include "brightness.h"
+#include "buttons.h"
+#include "tick.h"
+#include "transitions.h"
+#include "wear.h"
+
+static volatile unsigned long ticks = 0;
+
+ISR(TIMER0_COMPA_vect)
+{
+  ticks++;
+
+  buttonsTick();
+  brightnessTick();
+  transitionTick();
+  blinkTick();
+  wearTick();
+}
+
+void tickBegin()
+{
+  OCR0A = 0x80; // any value works, it is reached once per Timer0 cycle (pin 6 is an input so OC0A output isn't used)
+  TIMSK0 |= _BV(OCIE0A);
+}
+
+unsigned long tickCount()
+{
+  unsigned long count;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    count = ticks;
+  }
+  return count;
+}
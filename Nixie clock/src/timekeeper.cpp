@@ -0,0 +1,323 @@
+#include <Arduino.h>
+#include <util/atomic.h>
+#include "display.h"
+#include "ds3231.h"
+#include "log.h"
+#include "pins.h"
+#include "timekeeper.h"
+#include "transitions.h"
+
+unsigned long rtcReadsPerHour = 0;
+unsigned long timeRequestsPerHour = 0;
+volatile unsigned long lastEdgeLatency = 0;
+volatile unsigned long maxEdgeLatency = 0;
+
+const unsigned long seconds_per_day = 86400;
+const unsigned long rollover_poll_interval = 100; // how often is RTC read while waiting for the minute to change (in milliseconds)
+const unsigned long rollover_window = 2;          // RTC polling starts this many seconds before the minute is expected to change
+const unsigned long square_wave_timeout = 1500;   // square wave is considered missing if there is no tick for this long (in milliseconds)
+const unsigned long one_hour = 3600;              // in seconds
+const unsigned long sync_timeout = 50;            // a blocking resync gives up after this (in milliseconds)
+
+static unsigned long syncedTime = 0;   // seconds since midnight that were read from RTC module
+static byte syncedWeekday = 1;         // day of week that was read from RTC module
+static byte localWeekday = 1;          // day of week of the last local time
+static unsigned long syncMillis = 0;   // millis() when the RTC module was read
+static unsigned long syncTicks = 0;    // square wave ticks when the RTC module was read
+static unsigned long resyncPeriod = 0; // time between regular resyncs (in milliseconds)
+static bool syncRunning = false;       // RTC module is being read in the background
+static unsigned long syncStartTicks = 0;
+static bool refreshRequested = false;  // displayed time has to be refreshed, time was set
+
+// seconds since timekeeperBegin() and the ticks and millis() that were counted into them
+static unsigned long elapsed = 0;
+static unsigned long elapsedTicks = 0;
+static unsigned long elapsedMillis = 0;
+
+// updated from square wave interrupt
+static volatile unsigned long secondTicks = 0;
+static volatile unsigned long edgeMicros = 0;
+static volatile unsigned long edgeMillis = 0;
+
+// counters for the current hour
+static unsigned long rtcReads = 0;
+static unsigned long timeRequests = 0;
+static unsigned long hourStart = 0; // elapsedSeconds() when the hour started
+
+/*
+DS3231 seconds register changes on the falling edge of the 1Hz square wave, the frame for the new second
+is already waiting in the shift registers (if it was armed) so it is latched right here, unless a digit
+transition is playing: the armed frame is its next step then and it is latched from the system tick
+*/
+ISR(PCINT1_vect)
+{
+  if (!Board::SquareWave::read())
+  {
+    unsigned long edge = micros();
+
+    secondTicks++;
+    edgeMicros = edge;
+    edgeMillis = millis();
+    if (!transitionRunning() && latchArmedFrame())
+    {
+      lastEdgeLatency = micros() - edge;
+      if (lastEdgeLatency > maxEdgeLatency)
+        maxEdgeLatency = lastEdgeLatency;
+    }
+  }
+}
+
+// returns number of square wave ticks so far
+static unsigned long readTicks()
+{
+  unsigned long ticks;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    ticks = secondTicks;
+  }
+  return ticks;
+}
+
+// starts reading time from the RTC module in the background, finishSync() takes it when it is there
+static void startSync()
+{
+  if (syncRunning)
+    return;
+
+  syncStartTicks = readTicks();
+  syncRunning = ds3231StartRead();
+  if (syncRunning)
+    rtcReads++;
+}
+
+/*
+makes the time of a finished background read the new reference for local time, returns true if it did;
+the read is started again if the second changed during it, so time and tick count belong together
+*/
+static bool finishSync()
+{
+  RtcTime now;
+
+  if (!syncRunning || ds3231ReadBusy())
+    return false;
+
+  syncRunning = false;
+  if (!ds3231ReadResult(now))
+    return false; // tried again when local time is requested next
+  if (readTicks() != syncStartTicks)
+  {
+    startSync();
+    return false;
+  }
+
+  syncedTime = now.hour * 3600UL + now.minute * 60UL + now.second;
+  syncedWeekday = dayOfWeek(now.year, now.month, now.day);
+  syncMillis = millis();
+  syncTicks = syncStartTicks;
+  return true;
+}
+
+/*
+reads time from the RTC module and waits for it (at startup and after time was set); if the module doesn't answer
+within sync_timeout, local time goes on from the last sync and the next resync tries again
+*/
+static void syncLocalTime()
+{
+  unsigned long start = millis();
+
+  // a background read that is still running may be from before time was set
+  while (ds3231ReadBusy() && millis() - start < sync_timeout)
+    continue;
+  syncRunning = false;
+
+  while (millis() - start < sync_timeout)
+  {
+    startSync();
+    if (finishSync())
+      return;
+  }
+  log_warning("RTC module doesn't answer, time wasn't synced");
+}
+
+// moves counters of the last hour into the per hour values, hours are RTC time so time in power down counts
+static void updateHourlyCounters()
+{
+  if (!intervalPassed(hourStart, one_hour))
+    return;
+
+  rtcReadsPerHour = rtcReads;
+  timeRequestsPerHour = timeRequests;
+  rtcReads = 0;
+  timeRequests = 0;
+  log_info("RTC reads in the last hour: %u instead of %u", rtcReadsPerHour, timeRequestsPerHour);
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+  unsigned long latency;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    latency = maxEdgeLatency;
+  }
+  log_info("Maximum latency from second edge to display latch (us): %u", latency);
+#endif
+}
+
+void timekeeperBegin(unsigned long resyncInterval)
+{
+  resyncPeriod = resyncInterval;
+  elapsedMillis = millis();
+
+  ds3231EnableSquareWave();
+  Board::SquareWave::inputPullup(); // square wave output is open drain
+  Board::SquareWave::enablePinChange();
+
+  syncLocalTime();
+}
+
+void setResyncInterval(unsigned long resyncInterval)
+{
+  resyncPeriod = resyncInterval;
+}
+
+unsigned long squareWaveTicks()
+{
+  return readTicks();
+}
+
+unsigned long elapsedSeconds()
+{
+  unsigned long ticks = readTicks();
+
+  if (squareWaveActive())
+  {
+    elapsed += ticks - elapsedTicks;
+    elapsedMillis = millis();
+  }
+  else
+  {
+    while (millis() - elapsedMillis >= 1000)
+    {
+      elapsed++;
+      elapsedMillis += 1000;
+    }
+  }
+  elapsedTicks = ticks;
+  return elapsed;
+}
+
+bool intervalPassed(unsigned long &start, unsigned long interval)
+{
+  unsigned long now = elapsedSeconds();
+
+  if (now - start < interval)
+    return false;
+  start = now;
+  return true;
+}
+
+void lastSecondEdge(unsigned long &ticks, unsigned long &micros)
+{
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    ticks = secondTicks;
+    micros = edgeMicros;
+  }
+}
+
+bool squareWaveActive()
+{
+  unsigned long lastEdge;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    lastEdge = edgeMillis;
+  }
+  return readTicks() != 0 && millis() - lastEdge < square_wave_timeout;
+}
+
+void getLocalTime(int &hours, int &minutes, int &seconds)
+{
+  timeRequests++;
+  updateHourlyCounters();
+
+  // the RTC module is read in the background, local time changes over to it once the read is done
+  finishSync();
+
+  unsigned long sinceSync = millis() - syncMillis;
+  unsigned long currentTime;
+
+  if (squareWaveActive())
+  {
+    if (sinceSync >= resyncPeriod)
+      startSync();
+    currentTime = syncedTime + (readTicks() - syncTicks);
+  }
+  else
+  {
+    currentTime = syncedTime + sinceSync / 1000;
+    bool minuteExpired = currentTime / 60 != syncedTime / 60;
+    bool nearMinuteChange = currentTime % 60 >= 60 - rollover_window;
+
+    if (sinceSync >= resyncPeriod || ((minuteExpired || nearMinuteChange) && sinceSync >= rollover_poll_interval))
+      startSync();
+    if (minuteExpired)
+      currentTime = syncedTime - syncedTime % 60 + 59; // RTC hasn't confirmed the new minute yet
+  }
+
+  localWeekday = (syncedWeekday - 1 + currentTime / seconds_per_day) % 7 + 1;
+  currentTime %= seconds_per_day;
+  hours = currentTime / 3600;
+  minutes = currentTime / 60 % 60;
+  seconds = currentTime % 60;
+}
+
+void requestTimeRefresh()
+{
+  refreshRequested = true;
+}
+
+bool timeRefreshRequested()
+{
+  bool requested = refreshRequested;
+
+  refreshRequested = false;
+  return requested;
+}
+
+byte getLocalWeekday()
+{
+  return localWeekday;
+}
+
+void setRtcTime(int hours, int minutes, int seconds)
+{
+  RtcTime now;
+
+  if (!ds3231Read(now))
+    return; // date is unknown, writing it back would set garbage
+  now.hour = hours;
+  now.minute = minutes;
+  now.second = seconds;
+  ds3231Write(now);
+  syncLocalTime();
+}
+
+void setRtcDateTime(int year, int month, int day, int hours, int minutes, int seconds)
+{
+  RtcTime time = {year, (byte)month, (byte)day, (byte)hours, (byte)minutes, (byte)seconds};
+
+  ds3231Write(time);
+  syncLocalTime();
+}
+
+void recordEdgeLatency()
+{
+  unsigned long now = micros();
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    lastEdgeLatency = now - edgeMicros;
+    if (lastEdgeLatency > maxEdgeLatency)
+      maxEdgeLatency = lastEdgeLatency;
+  }
+}
@@ -0,0 +1,213 @@
+#include <Arduino.h>
+#include "display.h"
+#include "transitions.h"
+
+#define SHOW_OLD 0xFE // tube shows its old digit
+#define SHOW_NEW 0xFF // tube shows its new digit, any other value k shows the digit k before the new one
+
+struct TransitionStep
+{
+  byte ticks;    // how long is the step shown
+  byte selector; // what changing tubes show
+};
+
+static const TransitionStep slotMachineSteps[] PROGMEM = {
+    {20, 19}, {20, 18}, {20, 17}, {20, 16}, {20, 15}, {22, 14}, {24, 13}, {26, 12}, {28, 11}, {30, 10},
+    {33, 9}, {36, 8}, {40, 7}, {44, 6}, {48, 5}, {53, 4}, {58, 3}, {64, 2}, {70, 1}, {1, SHOW_NEW}};
+
+static const TransitionStep crossfadeSteps[] PROGMEM = {
+    {9, SHOW_OLD}, {1, SHOW_NEW}, {9, SHOW_OLD}, {1, SHOW_NEW}, {9, SHOW_OLD}, {1, SHOW_NEW},
+    {8, SHOW_OLD}, {2, SHOW_NEW}, {8, SHOW_OLD}, {2, SHOW_NEW}, {8, SHOW_OLD}, {2, SHOW_NEW},
+    {7, SHOW_OLD}, {3, SHOW_NEW}, {7, SHOW_OLD}, {3, SHOW_NEW}, {7, SHOW_OLD}, {3, SHOW_NEW},
+    {6, SHOW_OLD}, {4, SHOW_NEW}, {6, SHOW_OLD}, {4, SHOW_NEW}, {6, SHOW_OLD}, {4, SHOW_NEW},
+    {5, SHOW_OLD}, {5, SHOW_NEW}, {5, SHOW_OLD}, {5, SHOW_NEW}, {5, SHOW_OLD}, {5, SHOW_NEW},
+    {4, SHOW_OLD}, {6, SHOW_NEW}, {4, SHOW_OLD}, {6, SHOW_NEW}, {4, SHOW_OLD}, {6, SHOW_NEW},
+    {3, SHOW_OLD}, {7, SHOW_NEW}, {3, SHOW_OLD}, {7, SHOW_NEW}, {3, SHOW_OLD}, {7, SHOW_NEW},
+    {2, SHOW_OLD}, {8, SHOW_NEW}, {2, SHOW_OLD}, {8, SHOW_NEW}, {2, SHOW_OLD}, {8, SHOW_NEW},
+    {1, SHOW_OLD}, {9, SHOW_NEW}, {1, SHOW_OLD}, {9, SHOW_NEW}, {1, SHOW_OLD}, {1, SHOW_NEW}};
+
+static const TransitionStep cascadeSteps[] PROGMEM = {
+    {15, 9}, {15, 8}, {15, 7}, {15, 6}, {15, 5}, {15, 4}, {15, 3}, {15, 2}, {15, 1}, {1, SHOW_NEW}};
+
+const byte cascade_tube_delay = 4; // steps between the starts of two changing tubes in cascade
+
+static TransitionMode mode = TRANSITION_NONE;
+static const TransitionStep *steps; // steps of the playing transition
+static byte stepCount = 0;
+static byte totalSteps = 0;          // steps including delays between tubes
+static volatile byte step = 0;       // next step to be shown
+static volatile byte ticksLeft = 0;  // ticks until the next step
+static volatile byte stepTicks = 0;  // how long the next step is shown
+static volatile bool stepArmed = false; // frame of the next step waits in the shift registers
+static volatile bool running = false;
+
+static byte oldDigits[tube_count];
+static byte newDigits[tube_count];
+static byte oldBlank = 0;
+static byte newBlank = 0;
+static byte oldNeons = 0;
+static byte newNeons = 0;
+static byte startStep[tube_count];   // step where the tube starts its sequence, 0xFF if tube doesn't change
+
+/**
+ * Encodes the frame for a step of the transition
+ * @param frame frame to be filled
+ * @param globalStep step of the whole transition
+ * @return how many ticks the frame is shown
+ */
+static byte renderStep(byte *frame, byte globalStep)
+{
+  byte digits[tube_count];
+  byte blankMask = 0;
+  byte lastStart = 0; // start of the tube that started last, its step sets the pace (tubes start apart in cascade)
+
+  for (int i = 0; i < tube_count; i++)
+  {
+    byte selector = SHOW_NEW;
+    byte tubeMask = 1 << i;
+
+    if (startStep[i] != 0xFF && globalStep >= startStep[i] && startStep[i] > lastStart)
+      lastStart = startStep[i];
+
+    if (startStep[i] != 0xFF && globalStep >= startStep[i] && globalStep - startStep[i] < stepCount)
+      selector = pgm_read_byte(&steps[globalStep - startStep[i]].selector);
+    else if (startStep[i] != 0xFF && globalStep < startStep[i])
+      selector = SHOW_OLD;
+
+    if (selector == SHOW_OLD)
+    {
+      digits[i] = oldDigits[i];
+      blankMask |= oldBlank & tubeMask;
+    }
+    else if (selector == SHOW_NEW)
+    {
+      digits[i] = newDigits[i];
+      blankMask |= newBlank & tubeMask;
+    }
+    else
+      digits[i] = (newDigits[i] + selector) % 10;
+  }
+
+  // neons change with the tube that sets the pace, so they fade over with it in crossfade
+  const TransitionStep *paceStep = &steps[globalStep - lastStart];
+  byte neonMask = pgm_read_byte(&paceStep->selector) == SHOW_OLD ? oldNeons : newNeons;
+
+  encodeFrame(frame, digits, blankMask, neonMask);
+  return pgm_read_byte(&paceStep->ticks);
+}
+
+void setTransitionMode(TransitionMode transition)
+{
+  mode = transition;
+}
+
+TransitionMode transitionMode()
+{
+  return mode;
+}
+
+void startTransition(const byte *fromDigits, byte fromBlank, byte fromNeons, const byte *toDigits, byte toBlank,
+                     byte toNeons)
+{
+  stopTransition();
+
+  switch (mode)
+  {
+  case TRANSITION_SLOT_MACHINE:
+    steps = slotMachineSteps;
+    stepCount = sizeof(slotMachineSteps) / sizeof(TransitionStep);
+    break;
+  case TRANSITION_CROSSFADE:
+    steps = crossfadeSteps;
+    stepCount = sizeof(crossfadeSteps) / sizeof(TransitionStep);
+    break;
+  case TRANSITION_CASCADE:
+    steps = cascadeSteps;
+    stepCount = sizeof(cascadeSteps) / sizeof(TransitionStep);
+    break;
+  default:
+    displayDigits(toDigits, toBlank, toNeons);
+    return;
+  }
+
+  memcpy(oldDigits, fromDigits, tube_count);
+  memcpy(newDigits, toDigits, tube_count);
+  oldBlank = fromBlank;
+  newBlank = toBlank;
+  oldNeons = fromNeons;
+  newNeons = toNeons;
+
+  // changing tubes start one after another in cascade, all together otherwise
+  byte delay = mode == TRANSITION_CASCADE ? cascade_tube_delay : 0;
+  byte changing = 0;
+
+  totalSteps = 0;
+  for (int i = 0; i < tube_count; i++)
+  {
+    byte tubeMask = 1 << i;
+
+    if (fromDigits[i] != toDigits[i] || (fromBlank & tubeMask) != (toBlank & tubeMask))
+    {
+      startStep[i] = changing * delay;
+      totalSteps = startStep[i] + stepCount;
+      changing++;
+    }
+    else
+      startStep[i] = 0xFF;
+  }
+
+  if (changing == 0)
+  {
+    displayDigits(toDigits, toBlank, toNeons);
+    return;
+  }
+
+  step = 0;
+  ticksLeft = 1; // first step is shown on the next tick after it is armed
+  running = true;
+  transitionPoll();
+}
+
+void stopTransition()
+{
+  running = false;
+  if (stepArmed)
+    disarmFrame(); // frame of the next step mustn't be latched on a second edge
+  stepArmed = false;
+}
+
+bool transitionRunning()
+{
+  return running;
+}
+
+void transitionPoll()
+{
+  // step only changes in the tick interrupt once its frame is armed
+  if (!running || stepArmed)
+    return;
+
+  byte frame[frame_bytes];
+
+  stepTicks = renderStep(frame, step);
+  armFrame(frame); // nothing is armed if the step looks like the displayed frame, there is nothing to latch then
+  stepArmed = true;
+}
+
+void transitionTick()
+{
+  if (!running || --ticksLeft != 0)
+    return;
+
+  if (!stepArmed)
+  {
+    ticksLeft = 1; // loop hasn't shifted the step out yet, it is latched on the next tick
+    return;
+  }
+
+  latchArmedFrame();
+  stepArmed = false;
+  ticksLeft = stepTicks;
+  if (++step == totalSteps)
+    running = false;
+}
@@ -0,0 +1,189 @@
+#include <Arduino.h>
+#include <util/atomic.h>
+#include <util/twi.h>
+#include "pins.h"
+#include "twi.h"
+
+// TWCR values, the interrupt is enabled exactly while a transfer runs (see twiBusy())
+const byte twi_start = _BV(TWINT) | _BV(TWSTA) | _BV(TWEN) | _BV(TWIE);
+const byte twi_next = _BV(TWINT) | _BV(TWEN) | _BV(TWIE);   // send TWDR or receive and answer NACK
+const byte twi_next_ack = twi_next | _BV(TWEA);             // receive and answer ACK, more bytes follow
+const byte twi_stop = _BV(TWINT) | _BV(TWSTO) | _BV(TWEN); // interrupt off
+const unsigned long twi_timeout = 5000; // blocking waits give up after this (in microseconds), a transfer takes about 1ms
+
+static byte deviceAddress = 0;
+static byte registerAddress = 0;
+static bool reading = false;
+static byte *readData = nullptr;
+static byte writeData[twi_max_write];
+static byte length = 0;
+static byte position = 0;
+static void (*doneCallback)() = nullptr;
+static volatile TwiResult result = TWI_OK;
+
+void twiBegin(unsigned long frequency)
+{
+  Board::Sda::inputPullup();
+  Board::Scl::inputPullup();
+  TWSR = 0; // prescaler 1
+  TWBR = (F_CPU / frequency - 16) / 2;
+  TWCR = _BV(TWEN);
+}
+
+static void done(TwiResult transferResult)
+{
+  result = transferResult;
+  if (doneCallback)
+    doneCallback();
+}
+
+// ends the transfer with a stop condition
+static void finish(TwiResult transferResult)
+{
+  TWCR = twi_stop;
+  done(transferResult);
+}
+
+// turns the TWI off and on again, which lets go of the bus without a stop condition, and ends a running transfer
+static void reset()
+{
+  bool running = twiBusy();
+
+  TWCR = 0;
+  TWCR = _BV(TWEN);
+  if (running)
+    done(TWI_ERROR);
+}
+
+ISR(TWI_vect)
+{
+  switch (TW_STATUS)
+  {
+  case TW_START:
+    TWDR = deviceAddress << 1 | TW_WRITE;
+    TWCR = twi_next;
+    break;
+
+  case TW_REP_START:
+    TWDR = deviceAddress << 1 | TW_READ;
+    TWCR = twi_next;
+    break;
+
+  case TW_MT_SLA_ACK:
+    TWDR = registerAddress;
+    TWCR = twi_next;
+    break;
+
+  case TW_MT_DATA_ACK:
+    if (reading)
+      TWCR = twi_start; // repeated start, the device keeps the register address
+    else if (position < length)
+    {
+      TWDR = writeData[position++];
+      TWCR = twi_next;
+    }
+    else
+      finish(TWI_OK);
+    break;
+
+  case TW_MR_SLA_ACK:
+    TWCR = length > 1 ? twi_next_ack : twi_next;
+    break;
+
+  case TW_MR_DATA_ACK:
+    readData[position++] = TWDR;
+    TWCR = position < length - 1 ? twi_next_ack : twi_next; // the last byte is answered with NACK
+    break;
+
+  case TW_MR_DATA_NACK:
+    readData[position++] = TWDR;
+    finish(TWI_OK);
+    break;
+
+  case TW_MT_SLA_NACK:
+  case TW_MT_DATA_NACK:
+  case TW_MR_SLA_NACK:
+    finish(TWI_NACK);
+    break;
+
+  default: // bus error or lost arbitration
+    finish(TWI_ERROR);
+    break;
+  }
+}
+
+// starts a transfer that has been set up
+static void start(byte address, byte reg, byte count, void (*done)())
+{
+  unsigned long waitStart = micros();
+
+  // the stop condition of the last transfer may still be on the bus
+  while (TWCR & _BV(TWSTO))
+  {
+    if (micros() - waitStart >= twi_timeout)
+    {
+      reset();
+      break;
+    }
+  }
+
+  deviceAddress = address;
+  registerAddress = reg;
+  length = count;
+  position = 0;
+  doneCallback = done;
+  result = TWI_RUNNING;
+  TWCR = twi_start;
+}
+
+bool twiStartRead(byte address, byte reg, byte *data, byte count, void (*done)())
+{
+  if (twiBusy() || count == 0)
+    return false;
+
+  reading = true;
+  readData = data;
+  start(address, reg, count, done);
+  return true;
+}
+
+bool twiStartWrite(byte address, byte reg, const byte *data, byte count, void (*done)())
+{
+  if (twiBusy() || count > twi_max_write)
+    return false;
+
+  reading = false;
+  memcpy(writeData, data, count);
+  start(address, reg, count, done);
+  return true;
+}
+
+bool twiBusy()
+{
+  return TWCR & _BV(TWIE);
+}
+
+TwiResult twiResult()
+{
+  return result;
+}
+
+bool twiWait()
+{
+  unsigned long waitStart = micros();
+
+  while (twiBusy())
+  {
+    if (micros() - waitStart >= twi_timeout)
+    {
+      // the interrupt may finish the transfer right now
+      ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+      {
+        if (twiBusy())
+          reset();
+      }
+      break;
+    }
+  }
+  return result == TWI_OK;
+}
@@ -0,0 +1,115 @@
+#include <Arduino.h>
+#include <avr/eeprom.h>
+#include <util/atomic.h>
+#include "brightness.h"
+#include "display.h"
+#include "eeprom_layout.h"
+#include "timekeeper.h"
+#include "wear.h"
+
+const uint32_t wear_magic = 0x57450000UL | tube_count; // "WE" and number of tubes, anything else is not valid
+const int wear_counters = tube_count * 10;
+
+static uint32_t usage[tube_count][10];
+static byte sampleDivider = 0;
+
+// saving state
+static unsigned long lastSave = 0; // elapsedSeconds() at the last save
+static int saveIndex = -1;         // counter being saved, -1 when not saving
+static uint32_t saveValue;         // copy of the counter being saved
+static byte saveByte = 0;          // byte of the counter being saved
+
+void wearBegin()
+{
+  uint32_t magic;
+
+  eeprom_read_block(&magic, (const void *)wear_address, sizeof(magic));
+  if (magic == wear_magic)
+    eeprom_read_block(usage, (const void *)(wear_address + sizeof(magic)), sizeof(usage));
+  else
+  {
+    memset(usage, 0, sizeof(usage));
+    eeprom_update_block(&wear_magic, (void *)wear_address, sizeof(wear_magic));
+  }
+  lastSave = elapsedSeconds();
+}
+
+void wearTick()
+{
+  if (++sampleDivider < wear_sample_ticks)
+    return;
+  sampleDivider = 0;
+
+  byte digits[tube_count];
+
+  if (!displayIsLit() || !getDisplayedDigits(digits))
+    return;
+
+  for (int i = 0; i < tube_count; i++)
+  {
+    if (digits[i] < 10)
+      usage[i][digits[i]]++;
+  }
+}
+
+void wearSaveStep()
+{
+  if (saveIndex < 0)
+  {
+    if (!intervalPassed(lastSave, eeprom_save_interval))
+      return;
+    saveIndex = 0;
+    saveByte = 0;
+  }
+
+  if (!eeprom_is_ready())
+    return;
+
+  // take a copy of the counter before its first byte is written, so all 4 bytes belong together
+  if (saveByte == 0)
+  {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+      saveValue = usage[saveIndex / 10][saveIndex % 10];
+    }
+  }
+
+  uint8_t *address = (uint8_t *)(wear_address + sizeof(wear_magic) + saveIndex * sizeof(uint32_t) + saveByte);
+  eeprom_update_byte(address, ((byte *)&saveValue)[saveByte]);
+
+  if (++saveByte == sizeof(uint32_t))
+  {
+    saveByte = 0;
+    if (++saveIndex == wear_counters)
+      saveIndex = -1;
+  }
+}
+
+bool wearSaving()
+{
+  return saveIndex >= 0;
+}
+
+unsigned long cathodeUsage(int tube, int digit)
+{
+  unsigned long value;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    value = usage[tube][digit];
+  }
+  return value;
+}
+
+void printWearStatistics()
+{
+  Serial.println(F("cathode on time (hours), one tube per line, digits 0...9"));
+  for (int i = 0; i < tube_count; i++)
+  {
+    for (int j = 0; j < 10; j++)
+    {
+      Serial.print(cathodeUsage(i, j) * (wear_unit / 3600), 2);
+      Serial.print(j < 9 ? ' ' : '\n');
+    }
+  }
+}
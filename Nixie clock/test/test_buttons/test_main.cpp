@@ -0,0 +1,131 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "buttons.h"
+#include "host.h"
+#include "pins.h"
+
+/*
+Debouncing of the buttons: samples are fed to debounceButtons() like the system tick does, a button changes
+state after 4 equal samples that differ from it and every press and release is reported once.
+*/
+
+const byte stable_samples = 4;
+
+// feeds the same sample a number of times
+static void sample(byte pressed, int count)
+{
+  for (int i = 0; i < count; i++)
+    debounceButtons(pressed);
+}
+
+void setUp()
+{
+  // every test starts with all buttons released and nothing reported
+  sample(0, stable_samples);
+  buttonPresses();
+  buttonReleases();
+}
+
+void tearDown()
+{
+}
+
+static void test_press_after_stable_samples()
+{
+  sample(0x01, stable_samples - 1);
+  TEST_ASSERT_EQUAL_HEX8(0x00, buttonsDown());
+  TEST_ASSERT_EQUAL_HEX8(0x00, buttonPresses());
+
+  sample(0x01, 1);
+  TEST_ASSERT_EQUAL_HEX8(0x01, buttonsDown());
+  TEST_ASSERT_EQUAL_HEX8(0x01, buttonPresses());
+}
+
+static void test_press_is_reported_once()
+{
+  sample(0x02, 20);
+  TEST_ASSERT_TRUE(buttonPressed(1));
+  TEST_ASSERT_FALSE(buttonPressed(1));
+  TEST_ASSERT_EQUAL_HEX8(0x00, buttonPresses());
+}
+
+static void test_bounce_is_ignored()
+{
+  for (int i = 0; i < 20; i++)
+    sample(i % 2 ? 0x00 : 0x01, 1 + i % 3);
+  sample(0x00, stable_samples);
+  TEST_ASSERT_EQUAL_HEX8(0x00, buttonPresses());
+  TEST_ASSERT_EQUAL_HEX8(0x00, buttonReleases());
+}
+
+static void test_release_after_stable_samples()
+{
+  sample(0x04, stable_samples);
+  buttonPresses();
+
+  sample(0x00, stable_samples - 1);
+  TEST_ASSERT_EQUAL_HEX8(0x04, buttonsDown());
+  TEST_ASSERT_EQUAL_HEX8(0x00, buttonReleases());
+
+  sample(0x00, 1);
+  TEST_ASSERT_EQUAL_HEX8(0x00, buttonsDown());
+  TEST_ASSERT_EQUAL_HEX8(0x04, buttonReleases());
+  TEST_ASSERT_EQUAL_HEX8(0x00, buttonPresses());
+}
+
+static void test_dropout_while_held_is_ignored()
+{
+  sample(0x01, stable_samples);
+  buttonPresses();
+
+  for (int i = 0; i < 10; i++)
+  {
+    sample(0x00, stable_samples - 1);
+    sample(0x01, 1);
+  }
+  TEST_ASSERT_EQUAL_HEX8(0x01, buttonsDown());
+  TEST_ASSERT_EQUAL_HEX8(0x00, buttonReleases());
+  TEST_ASSERT_EQUAL_HEX8(0x00, buttonPresses());
+}
+
+static void test_buttons_are_independent()
+{
+  // button 0 is held steadily while button 2 bounces
+  for (int i = 0; i < stable_samples; i++)
+    debounceButtons(i % 2 ? 0x01 : 0x05);
+  TEST_ASSERT_EQUAL_HEX8(0x01, buttonsDown());
+
+  sample(0x05, stable_samples);
+  TEST_ASSERT_TRUE(buttonPressed(2));
+  TEST_ASSERT_TRUE(buttonPressed(0));
+  TEST_ASSERT_EQUAL_HEX8(0x05, buttonsDown());
+}
+
+static void test_sample_reads_button_pins()
+{
+  buttonsBegin(10);
+  hostDrivePin(Board::Button1::number, LOW); // pressed button pulls its pin down
+  for (int i = 0; i < stable_samples; i++)
+    sampleButtons();
+  TEST_ASSERT_TRUE(buttonsBusy());
+  TEST_ASSERT_EQUAL_HEX8(0x02, buttonPresses());
+
+  hostReleasePin(Board::Button1::number);
+  for (int i = 0; i < stable_samples; i++)
+    sampleButtons();
+  TEST_ASSERT_EQUAL_HEX8(0x02, buttonReleases());
+  TEST_ASSERT_FALSE(buttonsBusy());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_press_after_stable_samples);
+  RUN_TEST(test_press_is_reported_once);
+  RUN_TEST(test_bounce_is_ignored);
+  RUN_TEST(test_release_after_stable_samples);
+  RUN_TEST(test_dropout_while_held_is_ignored);
+  RUN_TEST(test_buttons_are_independent);
+  RUN_TEST(test_sample_reads_button_pins);
+  return UNITY_END();
+}
@@ -0,0 +1,199 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "blink.h"
+#include "buttons.h"
+#include "display.h"
+#include "host.h"
+#include "menu.h"
+#include "pins.h"
+#include "tick.h"
+
+/*
+Navigation of the setup menu: button presses go through the debouncer like on the clock, menuPoll() has to
+change the value of the current page within its range, move on to the next page and call the finish function
+after the last one. Blinking is driven by calling blinkTick() like the system tick does.
+*/
+
+const byte menu_button = 0;
+const byte up_button = 1;
+const byte down_button = 2;
+
+static int hours;
+static int minutes;
+static int finished;
+static int shown;        // number of times a page was drawn
+static byte shownBlank;  // blank mask of the last drawing
+static int shownHours;   // values at the last drawing
+static int shownMinutes;
+
+static void show(byte blankMask)
+{
+  shown++;
+  shownBlank = blankMask;
+  shownHours = hours;
+  shownMinutes = minutes;
+}
+
+static void finish()
+{
+  finished++;
+}
+
+static const MenuPage pages[] = {
+    {&hours, 0, 23, hour_1 | hour_2, MENU_HOUR_LED, show},
+    {&minutes, 0, 59, minute_1 | minute_2, MENU_MINUTE_LED, show},
+};
+
+// presses and releases a button with stable samples, like the system tick would sample it
+static void press(byte button)
+{
+  for (int i = 0; i < 4; i++)
+    debounceButtons(1 << button);
+  for (int i = 0; i < 4; i++)
+    debounceButtons(0);
+}
+
+// runs system ticks for a while (blinking only)
+static void runTicks(unsigned int milliseconds)
+{
+  for (unsigned int i = 0; i < milliseconds / tick_period; i++)
+    blinkTick();
+}
+
+void setUp()
+{
+  hours = 12;
+  minutes = 30;
+  finished = 0;
+  shown = 0;
+  menuEnter(pages, 2, finish);
+  menuPoll();
+}
+
+void tearDown()
+{
+}
+
+static void test_enter_draws_first_page()
+{
+  TEST_ASSERT_TRUE(menuActive());
+  TEST_ASSERT_EQUAL_INT(1, shown);
+  TEST_ASSERT_EQUAL_HEX8(0, shownBlank); // blinking starts with the digits shown
+  TEST_ASSERT_TRUE(hostPinLevel(Board::HourLed::number));
+  TEST_ASSERT_FALSE(hostPinLevel(Board::MinuteLed::number));
+}
+
+static void test_presses_before_enter_are_dropped()
+{
+  press(up_button);
+  menuEnter(pages, 2, finish);
+  menuPoll();
+  TEST_ASSERT_EQUAL_INT(12, hours);
+}
+
+static void test_poll_without_presses_draws_nothing()
+{
+  menuPoll();
+  menuPoll();
+  TEST_ASSERT_EQUAL_INT(1, shown);
+}
+
+static void test_up_and_down_change_value()
+{
+  press(up_button);
+  menuPoll();
+  TEST_ASSERT_EQUAL_INT(13, hours);
+  TEST_ASSERT_EQUAL_INT(13, shownHours);
+
+  press(down_button);
+  menuPoll();
+  press(down_button);
+  menuPoll();
+  TEST_ASSERT_EQUAL_INT(11, hours);
+  TEST_ASSERT_EQUAL_INT(11, shownHours);
+}
+
+static void test_value_wraps_around()
+{
+  hours = 23;
+  press(up_button);
+  menuPoll();
+  TEST_ASSERT_EQUAL_INT(0, hours);
+
+  press(down_button);
+  menuPoll();
+  TEST_ASSERT_EQUAL_INT(23, hours);
+}
+
+static void test_next_page_and_finish()
+{
+  press(menu_button);
+  menuPoll();
+  TEST_ASSERT_TRUE(menuActive());
+  TEST_ASSERT_FALSE(hostPinLevel(Board::HourLed::number));
+  TEST_ASSERT_TRUE(hostPinLevel(Board::MinuteLed::number));
+
+  press(up_button);
+  menuPoll();
+  TEST_ASSERT_EQUAL_INT(12, hours);
+  TEST_ASSERT_EQUAL_INT(31, minutes);
+  TEST_ASSERT_EQUAL_INT(31, shownMinutes);
+
+  press(menu_button);
+  menuPoll();
+  TEST_ASSERT_FALSE(menuActive());
+  TEST_ASSERT_EQUAL_INT(1, finished);
+  TEST_ASSERT_FALSE(hostPinLevel(Board::MinuteLed::number));
+
+  // a closed menu doesn't take presses anymore
+  press(up_button);
+  menuPoll();
+  TEST_ASSERT_EQUAL_INT(31, minutes);
+  TEST_ASSERT_EQUAL_INT(1, finished);
+}
+
+static void test_page_blinks()
+{
+  runTicks(blink_half_period + 2);
+  menuPoll();
+  TEST_ASSERT_EQUAL_INT(2, shown);
+  TEST_ASSERT_EQUAL_HEX8(hour_1 | hour_2, shownBlank);
+  TEST_ASSERT_FALSE(hostPinLevel(Board::HourLed::number));
+
+  runTicks(blink_half_period + 2);
+  menuPoll();
+  TEST_ASSERT_EQUAL_INT(3, shown);
+  TEST_ASSERT_EQUAL_HEX8(0, shownBlank);
+}
+
+static void test_change_shows_value_right_away()
+{
+  runTicks(blink_half_period + 2);
+  menuPoll();
+  TEST_ASSERT_EQUAL_HEX8(hour_1 | hour_2, shownBlank);
+
+  // blinked digits come back with the new value and stay for a whole half period
+  press(up_button);
+  menuPoll();
+  TEST_ASSERT_EQUAL_HEX8(0, shownBlank);
+  runTicks(blink_half_period - 10);
+  menuPoll();
+  TEST_ASSERT_EQUAL_HEX8(0, shownBlank);
+}
+
+int main()
+{
+  Board::HourLed::output();
+  Board::MinuteLed::output();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_enter_draws_first_page);
+  RUN_TEST(test_presses_before_enter_are_dropped);
+  RUN_TEST(test_poll_without_presses_draws_nothing);
+  RUN_TEST(test_up_and_down_change_value);
+  RUN_TEST(test_value_wraps_around);
+  RUN_TEST(test_next_page_and_finish);
+  RUN_TEST(test_page_blinks);
+  RUN_TEST(test_change_shows_value_right_away);
+  return UNITY_END();
+}
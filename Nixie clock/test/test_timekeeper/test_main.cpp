@@ -0,0 +1,150 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "ds3231.h"
+#include "host.h"
+#include "pins.h"
+#include "timekeeper.h"
+
+/*
+Time calculation of the timekeeper against the simulated DS3231 (lib/host): time is set over I2C, virtual time
+moves on and getLocalTime() has to follow the RTC across minute, hour and day changes, counting seconds from
+the square wave or from millis() when the square wave is missing.
+*/
+
+const unsigned long resync_interval = 60000; // in milliseconds
+
+// moves virtual time on by whole seconds, interrupts (square wave, millis()) run on the way
+static void runSeconds(unsigned long seconds)
+{
+  hostAdvance(seconds * host_nanoseconds_per_second);
+}
+
+// lets the RTC read that getLocalTime() starts when it is time to resync finish, like the loop would
+static void resync()
+{
+  int hours, minutes, seconds;
+
+  getLocalTime(hours, minutes, seconds);
+  hostAdvance(10000000ULL);
+}
+
+static void assertLocalTime(int hours, int minutes, int seconds)
+{
+  int localHours, localMinutes, localSeconds;
+
+  getLocalTime(localHours, localMinutes, localSeconds);
+  TEST_ASSERT_EQUAL_INT(hours, localHours);
+  TEST_ASSERT_EQUAL_INT(minutes, localMinutes);
+  TEST_ASSERT_EQUAL_INT(seconds, localSeconds);
+}
+
+void setUp()
+{
+  hostRtcConnectSquareWave(Board::SquareWave::number);
+}
+
+void tearDown()
+{
+}
+
+static void test_day_of_week()
+{
+  TEST_ASSERT_EQUAL_INT(6, dayOfWeek(2000, 1, 1));   // Saturday
+  TEST_ASSERT_EQUAL_INT(2, dayOfWeek(2000, 2, 29));  // Tuesday, 2000 is a leap year
+  TEST_ASSERT_EQUAL_INT(3, dayOfWeek(2000, 3, 1));   // Wednesday
+  TEST_ASSERT_EQUAL_INT(5, dayOfWeek(2021, 1, 1));   // Friday
+  TEST_ASSERT_EQUAL_INT(4, dayOfWeek(2024, 2, 29));  // Thursday
+  TEST_ASSERT_EQUAL_INT(4, dayOfWeek(2099, 12, 31)); // Thursday
+}
+
+static void test_days_in_month()
+{
+  TEST_ASSERT_EQUAL_INT(31, daysInMonth(2021, 1));
+  TEST_ASSERT_EQUAL_INT(28, daysInMonth(2021, 2));
+  TEST_ASSERT_EQUAL_INT(29, daysInMonth(2000, 2));
+  TEST_ASSERT_EQUAL_INT(29, daysInMonth(2024, 2));
+  TEST_ASSERT_EQUAL_INT(30, daysInMonth(2021, 4));
+  TEST_ASSERT_EQUAL_INT(31, daysInMonth(2021, 12));
+}
+
+static void test_time_after_set()
+{
+  setRtcDateTime(2021, 6, 15, 12, 34, 56);
+  assertLocalTime(12, 34, 56);
+  TEST_ASSERT_EQUAL_INT(2, getLocalWeekday()); // Tuesday
+}
+
+static void test_counts_seconds_from_square_wave()
+{
+  setRtcDateTime(2021, 6, 15, 12, 34, 56);
+  runSeconds(3);
+  TEST_ASSERT_TRUE(squareWaveActive());
+  assertLocalTime(12, 34, 59);
+  runSeconds(1);
+  assertLocalTime(12, 35, 0);
+  runSeconds(3600 - 35 * 60 + 5);
+  assertLocalTime(13, 0, 5);
+}
+
+static void test_day_change()
+{
+  setRtcDateTime(2021, 6, 20, 23, 59, 58); // Sunday
+  assertLocalTime(23, 59, 58);
+  TEST_ASSERT_EQUAL_INT(7, getLocalWeekday());
+  runSeconds(3);
+  assertLocalTime(0, 0, 1);
+  TEST_ASSERT_EQUAL_INT(1, getLocalWeekday()); // Monday
+}
+
+static void test_set_time_keeps_date()
+{
+  setRtcDateTime(2021, 6, 15, 8, 0, 0);
+  setRtcTime(21, 45, 30);
+  assertLocalTime(21, 45, 30);
+  TEST_ASSERT_EQUAL_INT(2, getLocalWeekday());
+}
+
+static void test_follows_drifting_rtc()
+{
+  setRtcDateTime(2021, 6, 15, 6, 0, 0);
+  hostRtcSetDrift(100); // gains 0.36s per hour
+  runSeconds(3 * 3600);
+  hostRtcSetDrift(0);
+  // local time counts RTC seconds, so it is the RTC time and not the time that passed
+  assertLocalTime(9, 0, 1);
+}
+
+static void test_without_square_wave()
+{
+  setRtcDateTime(2021, 6, 15, 10, 0, 0);
+  hostRtcConnectSquareWave(A1); // square wave pin isn't driven anymore
+  runSeconds(90);
+  TEST_ASSERT_FALSE(squareWaveActive());
+  // the new minute isn't shown before the RTC confirms it
+  assertLocalTime(10, 0, 59);
+  resync();
+  assertLocalTime(10, 1, 30);
+  runSeconds(3600);
+  resync();
+  assertLocalTime(11, 1, 30);
+}
+
+int main()
+{
+  hostRtcSet(0);
+  sei(); // done by the Arduino core before setup()
+  if (!ds3231Begin())
+    return 1;
+  timekeeperBegin(resync_interval);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_day_of_week);
+  RUN_TEST(test_days_in_month);
+  RUN_TEST(test_time_after_set);
+  RUN_TEST(test_counts_seconds_from_square_wave);
+  RUN_TEST(test_day_change);
+  RUN_TEST(test_set_time_keeps_date);
+  RUN_TEST(test_follows_drifting_rtc);
+  RUN_TEST(test_without_square_wave);
+  return UNITY_END();
+}
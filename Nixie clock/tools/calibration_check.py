@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""Runs the DS3231 calibration of nixie.py against the native build of the clock and checks the results.
+
+The clock is the simulator with --bridge (see lib/host/src/bridge.h): its virtual time is the reference clock,
+the crystal of its DS3231 is off by --drift and one step of the aging offset changes the frequency by
+--aging-step, which isn't the step nixie.py assumes. Written frames reach the clock after a random latency of
+up to --jitter, like through a USB serial adapter, so the offsets are noisy and have to be fitted.
+
+Steps:
+    calibrate - nixie.py calibrate until it leaves the aging offset as it is (at most 5 times), the first
+                measured drift has to be the simulated drift
+    verify    - nixie.py calibrate --dry-run, the drift that is left has to be within half a simulated step
+    align     - nixie.py set-time, then marks for 5 seconds: the RTC second has to start within the jitter of
+                the reference second
+
+Examples:
+    calibration_check.py                                  # .pio/build/native/program, 5.3ppm fast
+    calibration_check.py --drift -8 --aging-step 0.09 --jitter 500
+
+Exits with 1 if a result is off.
+"""
+
+import argparse
+import math
+import shlex
+import sys
+
+import nixie
+
+MAX_FIT_ERROR = 0.05  # measured drift may be this far off (in ppm)
+MAX_ALIGN_ERROR = 20  # RTC second may start this much further from the reference second than the jitter (in us)
+MAX_RUNS = 5  # 4 corrections and the run that confirms the last one
+ALIGN_MARKS = 5  # marks after the aligned set, like calibrate sends them, the last one counts
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--program", default=".pio/build/native/program", help="native build of the clock")
+    parser.add_argument("--drift", type=float, default=5.3, help="of the simulated crystal in ppm (default: 5.3)")
+    parser.add_argument("--aging-step", type=float, default=0.115,
+                        help="simulated ppm per aging offset step (default: 0.115, nixie.py assumes %g)" %
+                        nixie.AGING_STEP_PPM)
+    parser.add_argument("--jitter", type=float, default=200, help="latency of written frames in us (default: 200)")
+    parser.add_argument("--minutes", type=float, default=10, help="how long calibrate measures (default: 10)")
+    parser.add_argument("--seed", type=int, default=1, help="of the random latency (default: 1)")
+    args = parser.parse_args()
+
+    command = [args.program, "--bridge", "--drift", str(args.drift), "--aging-step", str(args.aging_step),
+               "--jitter", str(args.jitter), "--seed", str(args.seed)]
+    clock = nixie.Clock("sim:" + " ".join(shlex.quote(part) for part in command))
+    # mean latency is known (in ms like nixie.py --latency), like a measured one of an adapter
+    options = argparse.Namespace(minutes=args.minutes, latency=args.jitter / 2000, dry_run=False)
+    failed = False
+
+    print("calibrate:")
+    offset = clock.aging_offset()
+    for run in range(MAX_RUNS):
+        measured = nixie.calibrate(clock, options)
+        if run == 0 and abs(measured - args.drift) > MAX_FIT_ERROR:
+            print("calibrate: measured %+.3f ppm, simulated %+.3f ppm" % (measured, args.drift))
+            failed = True
+        if clock.aging_offset() == offset:
+            break
+        offset = clock.aging_offset()
+    else:
+        print("calibrate: aging offset still changes after %d runs" % MAX_RUNS)
+        failed = True
+
+    print("verify:")
+    options.dry_run = True
+    left = nixie.calibrate(clock, options)
+    if abs(left) > args.aging_step / 2 + MAX_FIT_ERROR:
+        print("verify: %+.3f ppm left, more than half a step of %.3f ppm" % (left, args.aging_step))
+        failed = True
+
+    print("align:")
+    clock.set_time_aligned(options.latency / 1000)
+    for _ in range(ALIGN_MARKS):
+        clock.wait_until(math.floor(clock.now()) + 1 + nixie.MARK_AFTER_EDGE)
+        _, _, _, align = clock.mark(options.latency / 1000)
+    print("RTC second starts %+d us from the reference second" % align)
+    if abs(align) > args.jitter + MAX_ALIGN_ERROR:
+        failed = True
+
+    print("failed" if failed else "passed")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,333 @@
+#!/usr/bin/env python3
+"""Host side of the Nixie clock binary protocol (see include/protocol.h).
+
+Examples:
+    nixie.py /dev/ttyUSB0 set-time                # set the clock to the time of this computer (to the ms)
+    nixie.py /dev/ttyUSB0 calibrate --minutes 60  # measure RTC drift against this computer and correct it
+    nixie.py /dev/ttyUSB0 aging                   # read (or write: aging -5) the aging offset
+    nixie.py /dev/ttyUSB0 read-config
+    nixie.py /dev/ttyUSB0 write-config brightness=20 motionTimeout=30
+    nixie.py /dev/ttyUSB0 stats
+    nixie.py /dev/ttyUSB0 wear
+    nixie.py /dev/ttyUSB0 routine
+    nixie.py "sim:.pio/build/native/program --bridge --drift 5.3" calibrate  # simulated clock (see below)
+
+Several ports can be given separated by commas to provision a number of clocks at once.
+A port sim:<command> runs the native build of the clock with --bridge (see lib/host/src/bridge.h) and talks
+to it over stdin and stdout, the virtual time of the simulator is the reference clock then.
+The clock of this computer is the reference for set-time and calibrate, so it should be synchronised (NTP).
+Calibration sends a mark every second, the clock answers with the offset of its RTC second edge from the
+reference second (see include/calibration.h). The drift is the slope of a line fitted to the offsets, it is
+corrected with the aging offset register of the DS3231 (about 0.1ppm per step, positive slows the RTC down).
+Requires pyserial (except for the simulator).
+"""
+
+import argparse
+import datetime
+import math
+import shlex
+import struct
+import subprocess
+import sys
+import time
+
+BAUD = 57600
+TIMEOUT = 0.5  # of a read (in seconds)
+SYNC = 0xA5
+
+PING = 0x01
+SET_TIME = 0x02
+READ_CONFIG = 0x03
+WRITE_CONFIG = 0x04
+READ_STATS = 0x05
+READ_WEAR = 0x06
+RUN_ROUTINE = 0x07
+CALIBRATION_MARK = 0x08
+AGING_OFFSET = 0x09
+SET_TIME_ALIGNED = 0x0A
+
+AGING_STEP_PPM = 0.1
+MARK_AFTER_EDGE = 0.05  # marks arrive this long after an RTC second edge, the MCU clock only times that much
+
+STATUS = {0: "ok", 1: "unknown command", 2: "bad length", 3: "busy", 4: "bad value"}
+
+# struct Settings in include/settings.h
+SETTINGS_FORMAT = "<BBHBBBBB"
+SETTINGS_FIELDS = ["cathodeInterval", "motionTimeout", "routineLength", "routineDigitDelay",
+                   "buttonSampleTicks", "brightness", "transition", "resyncInterval"]
+
+STATS_FIELDS = ["rtcReadsPerHour", "timeRequestsPerHour", "maxEdgeLatency", "framesLatched",
+                "framesSkipped", "sleepCount", "secondsAwake", "secondsAsleep"]
+
+MAX_TUBES = 6
+
+
+def crc16(data, crc=0xFFFF):
+    """CRC-16/CCITT as calculated by _crc_ccitt_update() of avr-libc"""
+    for byte in data:
+        byte ^= crc & 0xFF
+        byte = (byte ^ (byte << 4)) & 0xFF
+        crc = (((byte << 8) | (crc >> 8)) ^ (byte >> 4) ^ (byte << 3)) & 0xFFFF
+    return crc
+
+
+def frame(command, payload=b""):
+    body = bytes([len(payload), command]) + payload
+    return bytes([SYNC]) + body + struct.pack("<H", crc16(body))
+
+
+def wait_until(when):
+    """waits until the given time of this computer"""
+    while time.time() < when:
+        time.sleep(min(0.01, max(0, when - time.time())))
+
+
+class Simulator:
+    """native build of the clock as a serial port, see lib/host/src/bridge.h"""
+
+    EPOCH = 1609459200  # virtual time 0, 2021-01-01 00:00:00 like the RTC of the simulator at start
+
+    def __init__(self, command):
+        self.process = subprocess.Popen(command, stdin=subprocess.PIPE, stdout=subprocess.PIPE, text=True)
+        self.time = 0  # virtual nanoseconds
+
+    def command(self, line):
+        self.process.stdin.write(line + "\n")
+        self.process.stdin.flush()
+        answer = self.process.stdout.readline().split()
+        if not answer:
+            raise EOFError("simulator stopped")
+        self.time = int(answer[0])
+        return bytes(int(byte, 16) for byte in answer[1:])
+
+    def write(self, data):
+        self.command("write " + " ".join("%02x" % byte for byte in data))
+
+    def read(self, count):
+        return self.command("read %d %d" % (count, TIMEOUT * 1e9))
+
+    def now(self):
+        return self.EPOCH + self.time / 1e9
+
+    def wait_until(self, when):
+        self.command("wait %d" % max(0, (when - self.EPOCH) * 1e9))
+
+
+def open_port(port):
+    if port.startswith("sim:"):
+        return Simulator(shlex.split(port[4:]))
+    import serial  # only needed for real ports
+    return serial.Serial(port, BAUD, timeout=TIMEOUT)
+
+
+class Clock:
+    def __init__(self, port):
+        self.port = open_port(port)
+        # reference clock, this computer or the virtual time of the simulator
+        self.now = getattr(self.port, "now", time.time)
+        self.wait_until = getattr(self.port, "wait_until", wait_until)
+
+    def read_frame(self):
+        """returns (command, payload) of the next valid frame, None on timeout"""
+        while True:
+            byte = self.port.read(1)
+            if not byte:
+                return None
+            if byte[0] != SYNC:
+                sys.stdout.write(byte.decode("ascii", "replace"))  # debug output of the clock
+                continue
+            header = self.port.read(2)
+            if len(header) < 2:
+                return None
+            rest = self.port.read(header[0] + 2)
+            if len(rest) < header[0] + 2:
+                return None
+            body = header + rest[:-2]
+            if struct.unpack("<H", rest[-2:])[0] == crc16(body):
+                return header[1], rest[:-2]
+
+    def request(self, command, payload=b"", retries=3):
+        """sends a request and returns payload of the answer without status, a sleeping clock loses the first byte"""
+        for _ in range(retries):
+            self.port.write(frame(command, payload))
+            answer = self.read_frame()
+            if answer is None or answer[0] != command | 0x80:
+                continue
+            status, data = answer[1][0], answer[1][1:]
+            if status != 0:
+                raise RuntimeError(STATUS.get(status, "status %d" % status))
+            return data
+        raise TimeoutError("no answer")
+
+    def ping(self):
+        return self.request(PING)[0]
+
+    def set_time(self, when):
+        payload = struct.pack("<HBBBBB", when.year, when.month, when.day, when.hour, when.minute, when.second)
+        self.request(SET_TIME, payload)
+
+    def read_config(self):
+        return dict(zip(SETTINGS_FIELDS, struct.unpack(SETTINGS_FORMAT, self.request(READ_CONFIG))))
+
+    def write_config(self, config):
+        self.request(WRITE_CONFIG, struct.pack(SETTINGS_FORMAT, *[config[f] for f in SETTINGS_FIELDS]))
+
+    def stats(self):
+        return dict(zip(STATS_FIELDS, struct.unpack("<8L", self.request(READ_STATS))))
+
+    def wear(self, tube):
+        return list(struct.unpack("<10L", self.request(READ_WEAR, bytes([tube]))[1:]))
+
+    def run_routine(self):
+        self.request(RUN_ROUTINE)
+
+    def exchange(self, command, payload, retries=5):
+        """sends a timed request, payload(sent) builds it from the time it is sent, returns (sent, answer payload)"""
+        for _ in range(retries):
+            sent = self.now()
+            self.port.write(frame(command, payload(sent)))
+            answer = self.read_frame()
+            if answer is None or answer[0] != command | 0x80:
+                continue
+            if answer[1][0] == 3:
+                continue  # busy: the start bit wasn't timed, the clock is ready for the next frame
+            if answer[1][0] != 0:
+                raise RuntimeError(STATUS.get(answer[1][0], "status %d" % answer[1][0]))
+            return sent, answer[1][1:]
+        raise TimeoutError("no answer")
+
+    def mark(self, latency):
+        """returns reference time the mark was sent, RTC ticks, phase and offset (in microseconds)"""
+        sent, data = self.exchange(CALIBRATION_MARK, lambda sent: struct.pack("<L", int((sent + latency) % 1 * 1e6)))
+        return (sent,) + struct.unpack("<LLl", data)
+
+    def aging_offset(self, offset=None):
+        payload = b"" if offset is None else struct.pack("<b", offset)
+        return struct.unpack("<b", self.request(AGING_OFFSET, payload))[0]
+
+    def set_time_aligned(self, latency):
+        """sets the clock so its second starts with the next second of this computer"""
+        self.mark(latency)  # starts timing of start bits
+        boundary = math.floor(self.now()) + 1
+        if boundary - self.now() < 0.1:
+            boundary += 1
+        self.wait_until(boundary - 0.03)
+        when = datetime.datetime.fromtimestamp(boundary)
+
+        def payload(sent):
+            delay = int((boundary - sent - latency) * 1e6)
+            return struct.pack("<HBBBBBL", when.year, when.month, when.day, when.hour, when.minute, when.second, delay)
+
+        self.exchange(SET_TIME_ALIGNED, payload)
+
+
+def fit_line(points):
+    """least squares line through (x, y) points, returns slope, intercept and RMS of the residuals"""
+    n = len(points)
+    mean_x = sum(x for x, _ in points) / n
+    mean_y = sum(y for _, y in points) / n
+    sxx = sum((x - mean_x) ** 2 for x, _ in points)
+    slope = sum((x - mean_x) * (y - mean_y) for x, y in points) / sxx
+    intercept = mean_y - slope * mean_x
+    rms = math.sqrt(sum((y - intercept - slope * x) ** 2 for x, y in points) / n)
+    return slope, intercept, rms
+
+
+def calibrate(clock, args):
+    """measures the drift (returned in ppm) and corrects it unless it is a dry run"""
+    end = clock.now() + args.minutes * 60
+    next_mark = clock.now()
+    points = []
+    unwrap = 0
+
+    while clock.now() < end:
+        clock.wait_until(next_mark)
+        sent, ticks, phase, offset = clock.mark(args.latency / 1000)
+        # offsets wrap around at half a second
+        if points and offset + unwrap - points[-1][1] > 500000:
+            unwrap -= 1000000
+        elif points and offset + unwrap - points[-1][1] < -500000:
+            unwrap += 1000000
+        points.append((ticks, offset + unwrap))
+        next_mark = sent - phase / 1e6 + 1 + MARK_AFTER_EDGE
+        while next_mark < clock.now():
+            next_mark += 1
+        print("\r%4d marks, RTC second starts %+.3f ms from the reference" % (len(points), offset / 1000), end="")
+    print()
+
+    if len(points) < 10 or points[-1][0] == points[0][0]:
+        raise RuntimeError("not enough marks")
+    slope, _, rms = fit_line(points)
+    ppm = -slope  # a fast RTC starts its seconds earlier and earlier
+    current = clock.aging_offset()
+    wanted = max(-128, min(127, current + round(ppm / AGING_STEP_PPM)))
+    print("drift %+.3f ppm over %d seconds (RMS %.3f ms), aging offset %d -> %d" %
+          (ppm, points[-1][0] - points[0][0], rms / 1000, current, wanted))
+    if not args.dry_run and wanted != current:
+        clock.aging_offset(wanted)
+    return ppm
+
+
+def run(port, args):
+    clock = Clock(port)
+    version = clock.ping()
+    print("%s: protocol version %d" % (port, version))
+
+    if args.command == "set-time" and version >= 2:
+        clock.set_time_aligned(args.latency / 1000)
+    elif args.command == "set-time":
+        # time is set when the next second of this computer starts
+        now = datetime.datetime.now()
+        target = (now + datetime.timedelta(seconds=1)).replace(microsecond=0)
+        while datetime.datetime.now() < target:
+            pass
+        clock.set_time(target)
+    elif args.command == "read-config":
+        for key, value in clock.read_config().items():
+            print("%s=%d" % (key, value))
+    elif args.command == "write-config":
+        config = clock.read_config()
+        for item in args.values:
+            key, value = item.split("=")
+            if key not in config:
+                raise KeyError(key)
+            config[key] = int(value)
+        clock.write_config(config)
+    elif args.command == "stats":
+        for key, value in clock.stats().items():
+            print("%s=%d" % (key, value))
+    elif args.command == "wear":
+        for tube in range(MAX_TUBES):
+            try:
+                usage = clock.wear(tube)
+            except RuntimeError:
+                break  # clock has fewer tubes
+            print(" ".join("%.2f" % (units * 0.065536 / 3600) for units in usage))
+    elif args.command == "routine":
+        clock.run_routine()
+    elif args.command == "calibrate":
+        calibrate(clock, args)
+    elif args.command == "aging":
+        if args.values:
+            clock.aging_offset(int(args.values[0]))
+        print(clock.aging_offset())
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("ports", help="serial port(s), separated by commas")
+    parser.add_argument("command", choices=["ping", "set-time", "read-config", "write-config", "stats", "wear", "routine",
+                                            "calibrate", "aging"])
+    parser.add_argument("values", nargs="*", help="key=value pairs for write-config, new offset for aging")
+    parser.add_argument("--minutes", type=float, default=10, help="how long calibrate measures (default: 10)")
+    parser.add_argument("--dry-run", action="store_true", help="calibrate doesn't write the aging offset")
+    parser.add_argument("--latency", type=float, default=0,
+                        help="time from writing a frame to its start bit on the wire in ms (USB serial adapters)")
+    args = parser.parse_args()
+
+    for port in args.ports.split(","):
+        run(port, args)
+
+
+if __name__ == "__main__":
+    main()
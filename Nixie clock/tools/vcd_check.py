@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+"""Checks the shift register traffic in a VCD file and decodes the latched frames into digits.
+
+The VCD can come from the native build (program --vcd file) or from a logic analyser, signals are found by
+name (without scope). The TPIC6B595 chain is modelled like on the board: SRCK shifts DATA in on its rising edge
+while SRCLR (master_reset) is high, SRCLR low clears the stages, RCK (latch) rising copies them to the outputs.
+
+Problems that are reported:
+    latch while a frame is half shifted (clocks since the last latch aren't a multiple of the chain length)
+    data changing within the setup/hold window around a rising clock edge
+    clock or latch pulses shorter than the minimum pulse width
+    more than one cathode of a tube on in a latched frame
+
+Examples:
+    vcd_check.py day.vcd                        # 4 tubes, no neons
+    vcd_check.py --tubes 6 --neons 2 day.vcd
+    vcd_check.py --clock D4 --data D3 --latch D1 --reset D2 capture.vcd
+
+Exits with 1 if there are problems.
+"""
+
+import argparse
+import re
+import sys
+
+UNITS = {"s": 10 ** 15, "ms": 10 ** 12, "us": 10 ** 9, "ns": 10 ** 6, "ps": 10 ** 3, "fs": 1}
+
+
+def parse_vcd(path, names):
+    """Yields (time in fs, name, level) for every change of the named signals, times are in order."""
+    ids = {}
+    scale = UNITS["ns"]
+    time = 0
+    with open(path) as vcd:
+        tokens = (token for line in vcd for token in line.split())
+        for token in tokens:
+            if token == "$timescale":
+                text = ""
+                for part in tokens:
+                    if part == "$end":
+                        break
+                    text += part
+                match = re.fullmatch(r"(\d+)([munpf]?s)", text)
+                if not match:
+                    raise ValueError("unknown timescale " + text)
+                scale = int(match.group(1)) * UNITS[match.group(2)]
+            elif token == "$var":
+                fields = []
+                for part in tokens:
+                    if part == "$end":
+                        break
+                    fields.append(part)
+                name = fields[3].split(".")[-1]
+                if name in names:
+                    ids.setdefault(fields[2], []).append(name)
+            elif token in ("$dumpvars", "$dumpon", "$dumpoff", "$dumpall", "$end"):
+                continue
+            elif token.startswith("$"):
+                for part in tokens:
+                    if part == "$end":
+                        break
+            elif token[0] == "#":
+                time = int(token[1:]) * scale
+            elif token[0] in "01xXzZ":
+                for name in ids.get(token[1:], []):
+                    yield time, name, token[0] == "1"
+            elif token[0] in "bBrR":
+                next(tokens)  # vector or real value, none of the checked signals
+
+
+def format_time(fs):
+    us = fs // UNITS["us"]
+    seconds, us = divmod(us, 1000000)
+    minutes, seconds = divmod(seconds, 60)
+    hours, minutes = divmod(minutes, 60)
+    days, hours = divmod(hours, 24)
+    return "%dd %02d:%02d:%02d.%06d" % (days, hours, minutes, seconds, us)
+
+
+class Chain:
+    def __init__(self, tubes, neons):
+        self.tubes = tubes
+        self.neons = neons
+        self.bits = (tubes * 10 + neons + 7) // 8 * 8  # every TPIC6B595 has 8 stages
+        self.stages = 0  # bit k is the stage k clocks away from the data input
+        self.outputs = 0
+
+    def shift(self, data):
+        self.stages = (self.stages << 1 | data) & ((1 << self.bits) - 1)
+
+    def frame_bit(self, n):
+        """Returns bit n of the latched frame, bit 0 is shifted out first and ends at the far end."""
+        return self.outputs >> (self.bits - 1 - n) & 1
+
+    def digits(self):
+        """Returns the latched digits, ' ' for a blank tube and '#' if more than one cathode is on."""
+        text = ""
+        for tube in range(self.tubes):
+            on = [d for d in range(10) if self.frame_bit((self.tubes - 1 - tube) * 10 + d)]
+            if tube > 0 and tube % 2 == 0:
+                neons = self.neons == 0 or any(self.frame_bit(self.tubes * 10 + n) for n in range(self.neons))
+                text += ":" if neons else " "
+            text += " " if not on else str(on[0]) if len(on) == 1 else "#"
+        return text
+
+
+def check(args):
+    chain = Chain(args.tubes, args.neons)
+    clocks = args.clock.split(",")
+    window = int(args.window * UNITS["ns"])
+    min_pulse = int(args.min_pulse * UNITS["ns"])
+    names = set(clocks) | {args.data, args.latch, args.reset}
+    level = {args.reset: True}  # without a reset signal SRCLR is tied high
+    rises = {}
+    last_clock_rise = None
+    last_data_change = None
+    clocks_since_latch = 0
+    latches = 0
+    shown = None
+    problems = []
+
+    def problem(time, text):
+        problems.append("%s  %s" % (format_time(time), text))
+
+    for time, name, value in parse_vcd(args.file, names):
+        if level.get(name) == value:
+            continue
+        level[name] = value
+        if value:
+            rises[name] = time
+        elif name in rises and time - rises[name] < min_pulse and (name in clocks or name == args.latch):
+            problem(time, "%s pulse of %d ns" % (name, (time - rises[name]) // UNITS["ns"]))
+
+        if name == args.data:
+            if last_clock_rise is not None and time - last_clock_rise < window:
+                problem(time, "data changes %d ns after the clock edge" % ((time - last_clock_rise) // UNITS["ns"]))
+            last_data_change = time
+        elif name == args.reset and not value:
+            chain.stages = 0
+        elif name in clocks and value and level[args.reset]:
+            if last_data_change is not None and time - last_data_change < window:
+                problem(time, "data changes %d ns before the clock edge" % ((time - last_data_change) // UNITS["ns"]))
+            chain.shift(level.get(args.data, False))
+            last_clock_rise = time
+            clocks_since_latch += 1
+        elif name == args.latch and value:
+            if clocks_since_latch % chain.bits:
+                problem(time, "latch after %d clocks, frames are %d bits" % (clocks_since_latch, chain.bits))
+            chain.outputs = chain.stages
+            clocks_since_latch = 0
+            latches += 1
+            digits = chain.digits()
+            if "#" in digits:
+                problem(time, "more than one cathode on: %s" % digits)
+            if digits != shown and not args.quiet:
+                print("%s  %s" % (format_time(time), digits))
+            shown = digits
+
+    for text in problems:
+        print(text)
+    print("%d frames latched, %d problems" % (latches, len(problems)), file=sys.stderr)
+    return 1 if problems else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("file", help="VCD file")
+    parser.add_argument("--tubes", type=int, default=4, choices=[4, 6])
+    parser.add_argument("--neons", type=int, default=0)
+    parser.add_argument("--clock", default="clock,sck", help="SRCK signal(s), separated by commas (default: clock,sck)")
+    parser.add_argument("--data", default="data")
+    parser.add_argument("--latch", default="latch")
+    parser.add_argument("--reset", default="master_reset")
+    parser.add_argument("--window", type=float, default=20, help="setup and hold time in ns (default: 20)")
+    parser.add_argument("--min-pulse", type=float, default=40, help="minimum clock and latch pulse in ns (default: 40)")
+    parser.add_argument("--quiet", action="store_true", help="print problems only")
+    args = parser.parse_args()
+
+    sys.exit(check(args))
+
+
+if __name__ == "__main__":
+    main()